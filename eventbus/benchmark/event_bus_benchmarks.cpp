@@ -0,0 +1,637 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <eventbus/buffered_publisher.hpp>
+#include <eventbus/event_bus.hpp>
+#include <eventbus/event_scheduler.hpp>
+#include <eventbus/sharded_event_bus.hpp>
+#include <eventbus/static_event_bus.hpp>
+#include <eventbus/work_stealing_pool.hpp>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Benchmarks for dp::event_bus. Every scenario reports the time and the number of global heap
+ * allocations per operation. Results are written to stdout as JSON (default), CSV or a table:
+ *
+ *     eventbus.benchmarks [--format=json|csv|table] [--filter=<scenario substring>]
+ */
+
+namespace {
+    std::atomic<std::size_t> allocation_count{0};
+
+    void* counted_allocate(std::size_t size) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        if (auto* ptr = std::malloc(size == 0 ? 1 : size)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+
+    void* counted_allocate(std::size_t size, std::align_val_t alignment) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        const auto align = static_cast<std::size_t>(alignment);
+        if (auto* ptr = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+}  // namespace
+
+void* operator new(std::size_t size) { return counted_allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return counted_allocate(size, alignment);
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+namespace {
+    struct payload_event {
+        std::vector<char> payload;
+    };
+
+    template <std::size_t Index>
+    struct indexed_event {
+        std::size_t value{Index};
+    };
+
+    struct parameter {
+        std::string name;
+        std::string value;
+        bool is_number;
+    };
+
+    parameter param(std::string name, std::size_t value) {
+        return {std::move(name), std::to_string(value), true};
+    }
+
+    parameter param(std::string name, dp::dispatch_mode mode) {
+        return {std::move(name), mode == dp::dispatch_mode::locked ? "locked" : "lock_free",
+                false};
+    }
+
+    parameter param(std::string name, const char* value) { return {std::move(name), value, false}; }
+
+    struct measurement {
+        double ns_per_op{0.0};
+        double allocations_per_op{0.0};
+    };
+
+    struct result {
+        std::string scenario;
+        std::vector<parameter> parameters;
+        measurement value;
+    };
+
+    constexpr dp::dispatch_mode all_modes[] = {dp::dispatch_mode::locked,
+                                               dp::dispatch_mode::lock_free};
+
+    class benchmark_suite {
+      public:
+        explicit benchmark_suite(std::string filter) : filter_(std::move(filter)) {}
+
+        [[nodiscard]] bool enabled(const char* scenario) const {
+            return filter_.empty() || std::strstr(scenario, filter_.c_str()) != nullptr;
+        }
+
+        void add(const char* scenario, std::vector<parameter> parameters, measurement value) {
+            results_.push_back({scenario, std::move(parameters), value});
+        }
+
+        void print_json() const {
+            std::printf("{\n  \"benchmarks\": [");
+            for (std::size_t i = 0; i < results_.size(); ++i) {
+                const auto& item = results_[i];
+                std::printf("%s\n    {\"scenario\": \"%s\", \"parameters\": {", i ? "," : "",
+                            item.scenario.c_str());
+                for (std::size_t j = 0; j < item.parameters.size(); ++j) {
+                    const auto& p = item.parameters[j];
+                    std::printf(p.is_number ? "%s\"%s\": %s" : "%s\"%s\": \"%s\"",
+                                j ? ", " : "", p.name.c_str(), p.value.c_str());
+                }
+                std::printf("}, \"ns_per_op\": %.3f, \"allocations_per_op\": %.3f}",
+                            item.value.ns_per_op, item.value.allocations_per_op);
+            }
+            std::printf("\n  ]\n}\n");
+        }
+
+        void print_csv() const {
+            std::printf("scenario,parameters,ns_per_op,allocations_per_op\n");
+            for (const auto& item : results_) {
+                std::printf("%s,%s,%.3f,%.3f\n", item.scenario.c_str(),
+                            joined_parameters(item, ";").c_str(), item.value.ns_per_op,
+                            item.value.allocations_per_op);
+            }
+        }
+
+        void print_table() const {
+            std::printf("%-30s %-40s %14s %14s\n", "scenario", "parameters", "ns/op",
+                        "allocs/op");
+            for (const auto& item : results_) {
+                std::printf("%-30s %-40s %14.2f %14.3f\n", item.scenario.c_str(),
+                            joined_parameters(item, " ").c_str(), item.value.ns_per_op,
+                            item.value.allocations_per_op);
+            }
+        }
+
+      private:
+        static std::string joined_parameters(const result& item, const char* separator) {
+            std::string joined;
+            for (const auto& p : item.parameters) {
+                if (!joined.empty()) {
+                    joined += separator;
+                }
+                joined += p.name + "=" + p.value;
+            }
+            return joined;
+        }
+
+        std::string filter_;
+        std::vector<result> results_;
+    };
+
+    /**
+     * Time `iterations` calls of callable after a short warm up and count the global heap
+     * allocations made by any thread in the meantime.
+     */
+    template <typename Callable>
+    measurement measure(std::size_t iterations, std::size_t ops_per_iteration,
+                        Callable&& callable) {
+        for (std::size_t i = 0; i < iterations / 10 + 1; ++i) {
+            callable();
+        }
+        const auto allocations_before = allocation_count.load();
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            callable();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        const auto allocations = allocation_count.load() - allocations_before;
+
+        const auto ops = static_cast<double>(iterations * ops_per_iteration);
+        return {std::chrono::duration<double, std::nano>(end - start).count() / ops,
+                static_cast<double>(allocations) / ops};
+    }
+
+    std::vector<dp::handler_registration> register_payload_handlers(dp::event_bus& evt_bus,
+                                                                    std::size_t count,
+                                                                    std::size_t& sink) {
+        std::vector<dp::handler_registration> registrations;
+        for (std::size_t i = 0; i < count; ++i) {
+            registrations.emplace_back(evt_bus.register_handler<payload_event>(
+                [&sink](const payload_event& evt) { sink += evt.payload.size() + 1; }));
+        }
+        return registrations;
+    }
+
+    void fire_vs_handler_count(benchmark_suite& suite) {
+        constexpr auto scenario = "fire_vs_handler_count";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        for (const auto mode : all_modes) {
+            for (std::size_t handler_count = 1; handler_count <= 256; handler_count *= 4) {
+                dp::event_bus evt_bus(mode);
+                std::size_t sink{0};
+                const auto registrations = register_payload_handlers(evt_bus, handler_count, sink);
+                const payload_event evt{};
+                suite.add(scenario, {param("mode", mode), param("handlers", handler_count)},
+                          measure(200000, 1, [&]() { evt_bus.fire_event(evt); }));
+            }
+        }
+    }
+
+    void fire_vs_payload_size(benchmark_suite& suite) {
+        constexpr auto scenario = "fire_vs_payload_size";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        constexpr std::size_t handler_count = 16;
+        for (std::size_t payload_size = 16; payload_size <= 64 * 1024; payload_size *= 4) {
+            dp::event_bus evt_bus;
+            std::size_t sink{0};
+            const auto registrations = register_payload_handlers(evt_bus, handler_count, sink);
+            const payload_event evt{std::vector<char>(payload_size, 'x')};
+            suite.add(scenario,
+                      {param("handlers", handler_count), param("payload_bytes", payload_size)},
+                      measure(100000, 1, [&]() { evt_bus.fire_event(evt); }));
+        }
+    }
+
+    template <std::size_t... Indices>
+    void fire_vs_event_type_count(benchmark_suite& suite, const char* scenario,
+                                  std::index_sequence<Indices...>) {
+        constexpr auto type_count = sizeof...(Indices);
+        for (const auto mode : all_modes) {
+            dp::event_bus evt_bus(mode);
+            std::size_t sink{0};
+            std::vector<dp::handler_registration> registrations;
+            (registrations.emplace_back(evt_bus.register_handler<indexed_event<Indices>>(
+                 [&sink](const indexed_event<Indices>& evt) { sink += evt.value; })),
+             ...);
+
+            // fire every type once per iteration, in a fixed but type hopping order
+            using fire_function = void (*)(dp::event_bus&);
+            const fire_function fire_all[] = {
+                [](dp::event_bus& bus) { bus.fire_event(indexed_event<Indices>{}); }...};
+            suite.add(scenario, {param("mode", mode), param("event_types", type_count)},
+                      measure(200000 / type_count, type_count, [&]() {
+                          for (const auto fire : fire_all) {
+                              fire(evt_bus);
+                          }
+                      }));
+        }
+    }
+
+    void fire_vs_event_type_count(benchmark_suite& suite) {
+        constexpr auto scenario = "fire_vs_event_type_count";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        fire_vs_event_type_count(suite, scenario, std::make_index_sequence<1>{});
+        fire_vs_event_type_count(suite, scenario, std::make_index_sequence<8>{});
+        fire_vs_event_type_count(suite, scenario, std::make_index_sequence<64>{});
+        fire_vs_event_type_count(suite, scenario, std::make_index_sequence<256>{});
+    }
+
+    void fire_batched(benchmark_suite& suite) {
+        constexpr auto scenario = "fire_batched";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        constexpr std::size_t handler_count = 16;
+        dp::event_bus evt_bus;
+        std::size_t sink{0};
+        const auto registrations = register_payload_handlers(evt_bus, handler_count, sink);
+        for (std::size_t batch_size = 1; batch_size <= 1000; batch_size *= 10) {
+            const std::vector<payload_event> batch(batch_size);
+            const auto iterations = 1000000 / batch_size;
+            suite.add(scenario,
+                      {param("api", "fire_event"), param("handlers", handler_count),
+                       param("batch_size", batch_size)},
+                      measure(iterations, batch_size, [&]() {
+                          for (const auto& evt : batch) {
+                              evt_bus.fire_event(evt);
+                          }
+                      }));
+            suite.add(scenario,
+                      {param("api", "fire_events"), param("handlers", handler_count),
+                       param("batch_size", batch_size)},
+                      measure(iterations, batch_size, [&]() { evt_bus.fire_events(batch); }));
+        }
+    }
+
+    void static_vs_dynamic(benchmark_suite& suite) {
+        constexpr auto scenario = "static_vs_dynamic";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        for (std::size_t handler_count = 1; handler_count <= 64; handler_count *= 4) {
+            std::size_t sink{0};
+            dp::event_bus dynamic_bus;
+            dp::static_event_bus<payload_event> static_bus;
+            auto registrations = register_payload_handlers(dynamic_bus, handler_count, sink);
+            for (std::size_t i = 0; i < handler_count; ++i) {
+                registrations.emplace_back(static_bus.register_handler<payload_event>(
+                    [&sink](const payload_event& evt) { sink += evt.payload.size() + 1; }));
+            }
+            const payload_event evt{};
+            suite.add(scenario, {param("bus", "event_bus"), param("handlers", handler_count)},
+                      measure(1000000, 1, [&]() { dynamic_bus.fire_event(evt); }));
+            suite.add(scenario,
+                      {param("bus", "static_event_bus"), param("handlers", handler_count)},
+                      measure(1000000, 1, [&]() { static_bus.fire_event(evt); }));
+        }
+
+        // the handlers of a static_dispatcher are fixed at compile time and inlined, the sink is
+        // volatile so the loop is not folded into a single addition
+        volatile std::size_t sink{0};
+        const auto handler = [&sink](const payload_event& evt) {
+            sink = sink + evt.payload.size() + 1;
+        };
+        dp::static_dispatcher dispatcher{handler, handler, handler, handler};
+        const payload_event evt{};
+        suite.add(scenario, {param("bus", "static_dispatcher"), param("handlers", 4)},
+                  measure(1000000, 1, [&]() { dispatcher.fire_event(evt); }));
+    }
+
+    void register_unregister_churn(benchmark_suite& suite) {
+        constexpr auto scenario = "register_unregister_churn";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        for (const auto mode : all_modes) {
+            for (const std::size_t resident : {0U, 8U, 64U, 512U}) {
+                dp::event_bus evt_bus(mode);
+                std::size_t sink{0};
+                const auto registrations = register_payload_handlers(evt_bus, resident, sink);
+                // one operation is a registration plus its removal
+                suite.add(scenario, {param("mode", mode), param("resident_handlers", resident)},
+                          measure(200000, 1, [&]() {
+                              auto registration = evt_bus.register_handler<payload_event>(
+                                  [&sink](const payload_event&) { ++sink; });
+                              evt_bus.remove_handler(registration);
+                          }));
+            }
+        }
+    }
+
+    void contended_fire_with_churn(benchmark_suite& suite) {
+        constexpr auto scenario = "contended_fire_with_churn";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        constexpr std::size_t events_per_thread = 100000;
+        for (const auto mode : all_modes) {
+            for (std::size_t thread_count = 1; thread_count <= 64; thread_count *= 2) {
+                dp::event_bus evt_bus(mode);
+                std::size_t sink{0};
+                const auto registrations = register_payload_handlers(evt_bus, 4, sink);
+
+                std::atomic<bool> done{false};
+                auto churn_thread = std::thread([&evt_bus, &done]() {
+                    while (!done.load(std::memory_order_relaxed)) {
+                        auto registration =
+                            evt_bus.register_handler<payload_event>([](const payload_event&) {});
+                        std::this_thread::yield();
+                    }
+                });
+
+                // one iteration runs all firing threads to completion
+                const auto value = measure(1, thread_count * events_per_thread, [&]() {
+                    std::vector<std::thread> threads;
+                    for (std::size_t i = 0; i < thread_count; ++i) {
+                        threads.emplace_back([&evt_bus]() {
+                            const payload_event evt{};
+                            for (std::size_t j = 0; j < events_per_thread; ++j) {
+                                evt_bus.fire_event(evt);
+                            }
+                        });
+                    }
+                    for (auto& thread : threads) {
+                        thread.join();
+                    }
+                });
+                done = true;
+                churn_thread.join();
+
+                // ns_per_op is wall time per fire across all threads, the inverse of throughput
+                suite.add(scenario, {param("mode", mode), param("threads", thread_count)},
+                          value);
+            }
+        }
+    }
+
+    /**
+     * Fire one event type from many threads while another thread keeps registering and removing
+     * handlers of an unrelated type. With a single event_bus the churn contends on the same lock
+     * as the dispatches, with a sharded_event_bus it does not.
+     */
+    template <typename Bus>
+    measurement fire_with_unrelated_churn(Bus& evt_bus, std::size_t thread_count) {
+        constexpr std::size_t events_per_thread = 100000;
+        std::size_t sink{0};
+        const auto registration = evt_bus.template register_handler<indexed_event<0>>(
+            [&sink](const indexed_event<0>& evt) { sink += evt.value; });
+
+        std::atomic<bool> done{false};
+        auto churn_thread = std::thread([&evt_bus, &done]() {
+            while (!done.load(std::memory_order_relaxed)) {
+                auto churn_registration =
+                    evt_bus.template register_handler<payload_event>([]() {});
+            }
+        });
+
+        const auto value = measure(1, thread_count * events_per_thread, [&]() {
+            std::vector<std::thread> threads;
+            for (std::size_t i = 0; i < thread_count; ++i) {
+                threads.emplace_back([&evt_bus]() {
+                    const indexed_event<0> evt{};
+                    for (std::size_t j = 0; j < events_per_thread; ++j) {
+                        evt_bus.fire_event(evt);
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        });
+        done = true;
+        churn_thread.join();
+        return value;
+    }
+
+    void unrelated_type_churn(benchmark_suite& suite) {
+        constexpr auto scenario = "unrelated_type_churn";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        for (const auto mode : all_modes) {
+            for (std::size_t thread_count = 1; thread_count <= 16; thread_count *= 2) {
+                {
+                    dp::event_bus evt_bus(mode);
+                    suite.add(scenario,
+                              {param("bus", "event_bus"), param("mode", mode),
+                               param("threads", thread_count)},
+                              fire_with_unrelated_churn(evt_bus, thread_count));
+                }
+                {
+                    dp::sharded_event_bus evt_bus(8, mode);
+                    suite.add(scenario,
+                              {param("bus", "sharded_event_bus"), param("mode", mode),
+                               param("threads", thread_count)},
+                              fire_with_unrelated_churn(evt_bus, thread_count));
+                }
+            }
+        }
+    }
+
+    /**
+     * Publish one event type from many threads, either with fire_event or through the thread
+     * local buffers of a buffered_publisher.
+     */
+    void contended_buffered_publish(benchmark_suite& suite) {
+        constexpr auto scenario = "contended_buffered_publish";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        constexpr std::size_t events_per_thread = 100000;
+        for (std::size_t thread_count = 1; thread_count <= 16; thread_count *= 2) {
+            dp::event_bus evt_bus;
+            std::atomic<std::size_t> sink{0};
+            const auto registration = evt_bus.register_batch_handler<indexed_event<0>>(
+                [&sink](dp::event_batch<indexed_event<0>> batch) {
+                    sink.fetch_add(batch.size(), std::memory_order_relaxed);
+                });
+
+            const auto run_producers = [thread_count](auto&& publish) {
+                std::vector<std::thread> threads;
+                for (std::size_t i = 0; i < thread_count; ++i) {
+                    threads.emplace_back([&publish]() {
+                        const indexed_event<0> evt{};
+                        for (std::size_t j = 0; j < events_per_thread; ++j) {
+                            publish(evt);
+                        }
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+            };
+
+            suite.add(scenario, {param("api", "fire_event"), param("threads", thread_count)},
+                      measure(1, thread_count * events_per_thread, [&]() {
+                          run_producers(
+                              [&evt_bus](const indexed_event<0>& evt) { evt_bus.fire_event(evt); });
+                      }));
+
+            dp::buffered_publisher publisher(evt_bus);
+            suite.add(scenario,
+                      {param("api", "buffered_publisher"), param("threads", thread_count)},
+                      measure(1, thread_count * events_per_thread, [&]() {
+                          run_producers([&publisher](const indexed_event<0>& evt) {
+                              publisher.publish(evt);
+                          });
+                          publisher.flush();
+                      }));
+        }
+    }
+
+    /**
+     * Fire an event to handlers that each do a little work, on the calling thread and fanned out
+     * over a work_stealing_pool.
+     */
+    void parallel_fan_out(benchmark_suite& suite) {
+        constexpr auto scenario = "parallel_fan_out";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        constexpr std::size_t handler_count = 64;
+        constexpr std::size_t work_per_handler = 500;
+        dp::event_bus evt_bus(dp::dispatch_mode::lock_free);
+        std::atomic<std::size_t> sink{0};
+        std::vector<dp::handler_registration> registrations;
+        for (std::size_t i = 0; i < handler_count; ++i) {
+            registrations.emplace_back(
+                evt_bus.register_handler<indexed_event<0>>([&sink](const indexed_event<0>& evt) {
+                    auto value = evt.value;
+                    for (std::size_t j = 0; j < work_per_handler; ++j) {
+                        value = value * 31 + j;
+                    }
+                    sink.fetch_add(value, std::memory_order_relaxed);
+                }));
+        }
+
+        suite.add(scenario, {param("api", "fire_event"), param("threads", std::size_t{0})},
+                  measure(2000, 1, [&]() { evt_bus.fire_event(indexed_event<0>{}); }));
+        for (std::size_t thread_count = 1; thread_count <= 8; thread_count *= 2) {
+            dp::work_stealing_pool pool(thread_count);
+            suite.add(scenario,
+                      {param("api", "fire_event_parallel"), param("threads", thread_count)},
+                      measure(2000, 1, [&]() {
+                          evt_bus.fire_event_parallel(indexed_event<0>{}, pool);
+                      }));
+        }
+    }
+
+    /**
+     * Schedule and cancel a timer while many other timers are pending, which should not depend
+     * on how many there are.
+     */
+    void timer_schedule_cancel(benchmark_suite& suite) {
+        constexpr auto scenario = "timer_schedule_cancel";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        dp::event_bus evt_bus;
+        for (std::size_t pending = 1000; pending <= 1000000; pending *= 10) {
+            dp::event_scheduler scheduler(evt_bus);
+            std::vector<dp::timer_registration> timers;
+            timers.reserve(pending);
+            for (std::size_t i = 0; i < pending; ++i) {
+                timers.push_back(scheduler.schedule_event(
+                    indexed_event<0>{}, std::chrono::seconds(60) + std::chrono::microseconds(i)));
+            }
+            std::size_t i{0};
+            suite.add(scenario, {param("pending", pending)}, measure(100000, 1, [&]() {
+                          auto timer = scheduler.schedule_event(
+                              indexed_event<0>{},
+                              std::chrono::milliseconds(100 + i++ % 50000));
+                          timer.cancel();
+                      }));
+        }
+    }
+
+    /**
+     * Fire an event of a type whose most recent event is cached for late handlers, compared to
+     * the same type without the cache.
+     */
+    void sticky_fire(benchmark_suite& suite) {
+        constexpr auto scenario = "sticky_fire";
+        if (!suite.enabled(scenario)) {
+            return;
+        }
+        for (const auto mode : all_modes) {
+            for (const auto sticky : {false, true}) {
+                dp::event_bus evt_bus(mode);
+                std::size_t sink{0};
+                if (sticky) {
+                    evt_bus.make_sticky<payload_event>();
+                }
+                const auto registrations = register_payload_handlers(evt_bus, 4, sink);
+                const payload_event evt{std::vector<char>(64, 'x')};
+                suite.add(scenario,
+                          {param("mode", mode), param("sticky", sticky ? "true" : "false")},
+                          measure(1000000, 1, [&]() { evt_bus.fire_event(evt); }));
+            }
+        }
+    }
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string format = "json";
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument.rfind("--format=", 0) == 0) {
+            format = argument.substr(9);
+        } else if (argument.rfind("--filter=", 0) == 0) {
+            filter = argument.substr(9);
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--format=json|csv|table] [--filter=<scenario substring>]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    benchmark_suite suite(filter);
+    fire_vs_handler_count(suite);
+    fire_vs_payload_size(suite);
+    fire_vs_event_type_count(suite);
+    fire_batched(suite);
+    static_vs_dynamic(suite);
+    register_unregister_churn(suite);
+    contended_fire_with_churn(suite);
+    unrelated_type_churn(suite);
+    contended_buffered_publish(suite);
+    parallel_fan_out(suite);
+    timer_schedule_cancel(suite);
+    sticky_fire(suite);
+
+    if (format == "csv") {
+        suite.print_csv();
+    } else if (format == "table") {
+        suite.print_table();
+    } else {
+        suite.print_json();
+    }
+    return 0;
+}
@@ -0,0 +1,538 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "detail/inplace_handler.hpp"
+#include "detail/ring_buffer.hpp"
+#include "event_bus.hpp"
+
+namespace dp {
+    /**
+     * @brief How posted events are spread over the workers of an async_event_bus.
+     */
+    enum class dispatch_order {
+        /**
+         * @brief All events of a type are dispatched by the same worker, in the order they were
+         * posted.
+         */
+        per_type,
+        /**
+         * @brief Events are spread over all workers. Events of the same type may be dispatched
+         * concurrently and out of order.
+         */
+        unordered
+    };
+
+    /**
+     * @brief What posting an event does when the queue of its worker is full.
+     */
+    enum class overflow_policy {
+        /**
+         * @brief Wait until the worker made room. Handlers must not post to a full queue of the
+         * worker they run on, which would wait forever.
+         */
+        block,
+        /**
+         * @brief Discard the posted event.
+         */
+        drop_newest,
+        /**
+         * @brief Discard the event that was queued first and queue the posted event.
+         */
+        drop_oldest,
+        /**
+         * @brief Discard the posted event and report post_result::queue_full.
+         */
+        fail
+    };
+
+    /**
+     * @brief Capacity and overflow behavior of the queues of an async_event_bus.
+     */
+    struct queue_options {
+        /**
+         * @brief Maximum number of events queued per worker, 0 for unbounded queues. Bounded
+         * queues allocate all of their slots when the bus is created.
+         */
+        std::size_t capacity{0};
+        overflow_policy overflow{overflow_policy::block};
+    };
+
+    /**
+     * @brief Outcome of async_event_bus::post_event.
+     */
+    enum class post_result {
+        /**
+         * @brief The event was queued, or merged into a queued event of a conflated type.
+         */
+        posted,
+        /**
+         * @brief The queue was full and the event was discarded, see overflow_policy::drop_newest.
+         */
+        dropped,
+        /**
+         * @brief The queue was full and the event was discarded, see overflow_policy::fail.
+         */
+        queue_full,
+        /**
+         * @brief The bus was shut down and the event was discarded.
+         */
+        stopped
+    };
+
+    /**
+     * @brief Counters of the queue of one worker of an async_event_bus.
+     */
+    struct async_queue_stats {
+        /**
+         * @brief Events currently queued.
+         */
+        std::size_t queued{0};
+        /**
+         * @brief The largest number of events that were queued at once.
+         */
+        std::size_t high_water{0};
+        /**
+         * @brief Events queued in total, events merged by conflation are not counted.
+         */
+        std::uint64_t posted{0};
+        /**
+         * @brief Events discarded by overflow_policy::drop_newest or overflow_policy::drop_oldest.
+         */
+        std::uint64_t dropped{0};
+        /**
+         * @brief Events refused by overflow_policy::fail.
+         */
+        std::uint64_t rejected{0};
+    };
+
+    namespace detail {
+        // key of conflated events when all events of a type share one key
+        struct same_key {
+            template <typename EventType>
+            constexpr std::monostate operator()(const EventType&) const noexcept {
+                return {};
+            }
+        };
+
+        // conflation that keeps only the latest event
+        struct replace_event {
+            template <typename EventType>
+            void operator()(EventType& queued, EventType&& latest) const {
+                queued = std::move(latest);
+            }
+        };
+    }  // namespace detail
+
+    /**
+     * @brief Dispatches events to the handlers of an event_bus on a pool of worker threads.
+     * @details Posting an event costs one enqueue no matter how many handlers are registered, the
+     * handlers run later on one of the workers through event_bus::fire_event. Handlers are
+     * registered on the underlying event_bus as usual. The event_bus must outlive this object.
+     *
+     * Every worker has its own queue. Queues are unbounded by default, bounded queues keep memory
+     * use predictable when handlers fall behind, see queue_options.
+     */
+    class async_event_bus {
+      public:
+        /**
+         * @brief Create an async event bus.
+         * @param bus The event bus whose handlers will be called.
+         * @param worker_count Number of worker threads, at least one worker is always started.
+         * @param resource Memory resource for queued events. Producers and workers allocate from
+         * it concurrently, so it must be thread safe. It must outlive this object.
+         */
+        explicit async_event_bus(
+            event_bus& bus, std::size_t worker_count = std::thread::hardware_concurrency(),
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : async_event_bus(bus, worker_count, queue_options{}, resource) {}
+
+        /**
+         * @brief Create an async event bus with bounded queues.
+         * @param bus The event bus whose handlers will be called.
+         * @param worker_count Number of worker threads, at least one worker is always started.
+         * @param options Capacity of the queue of every worker and what to do when one is full.
+         * @param resource Memory resource for queued events. Producers and workers allocate from
+         * it concurrently, so it must be thread safe. It must outlive this object.
+         */
+        async_event_bus(event_bus& bus, std::size_t worker_count, const queue_options& options,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : bus_(bus), resource_(resource) {
+            worker_count = std::max<std::size_t>(1, worker_count);
+            workers_.reserve(worker_count);
+            for (std::size_t i = 0; i < worker_count; ++i) {
+                workers_.push_back(std::make_unique<worker>(resource, options));
+            }
+            for (auto& w : workers_) {
+                w->thread = std::thread([this, w = w.get()]() { run(*w); });
+            }
+        }
+
+        async_event_bus(const async_event_bus&) = delete;
+        async_event_bus& operator=(const async_event_bus&) = delete;
+
+        /**
+         * @brief Dispatches all pending events and stops the workers.
+         */
+        ~async_event_bus() { shutdown(); }
+
+        /**
+         * @brief Conflate queued events of a type, for "latest value wins" updates.
+         * @details While an event of the type waits in the queue, posting another event with the
+         * same key does not queue it, but merges it into the queued event, which by default means
+         * replacing it. Handlers therefore only see the latest state and the queue holds at most
+         * one event per key, however fast events are posted. The merged event is dispatched at
+         * the position of the first queued event of its key.
+         *
+         * Conflated events are always dispatched in dispatch_order::per_type. Call this before
+         * events of the type are posted, later calls for the same type are ignored.
+         * @tparam EventType The event type
+         * @param key_extractor Member pointer or callable that returns the key of an event, the
+         * key must work with std::hash. By default all events of the type share one key.
+         * @param merge Called as `merge(EventType& queued, EventType&& latest)` with the lock of a
+         * worker held.
+         */
+        template <typename EventType, typename KeyExtractor = detail::same_key,
+                  typename Merge = detail::replace_event>
+        void conflate(KeyExtractor key_extractor = {}, Merge merge = {}) {
+            const auto event_type = detail::type_id<EventType>();
+            auto& target = *workers_[event_type % workers_.size()];
+            auto policy = std::make_unique<conflation<EventType, KeyExtractor, Merge>>(
+                bus_, resource_, std::move(key_extractor), std::move(merge));
+
+            std::lock_guard<std::mutex> lock(target.mutex);
+            if (target.conflations.size() <= event_type) {
+                target.conflations.resize(event_type + 1);
+            }
+            if (!target.conflations[event_type]) {
+                target.conflations[event_type] = std::move(policy);
+                conflated_types_.fetch_add(1, std::memory_order_release);
+            }
+        }
+
+        /**
+         * @brief Queue an event to be fired on a worker thread.
+         * @details If the queue of the worker is full, the overflow_policy of the bus decides what
+         * happens.
+         * @tparam EventType The event type
+         * @param evt The event, it is copied or moved into the queue.
+         * @param order Whether events of this type must keep their order.
+         * @return post_result::posted if the event will be dispatched.
+         */
+        template <typename EventType,
+                  typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<EventType>>>>
+        post_result post_event(EventType&& evt, dispatch_order order = dispatch_order::per_type) {
+            using event_type = std::decay_t<EventType>;
+            auto& typed = *workers_[detail::type_id<event_type>() % workers_.size()];
+            if (conflated_types_.load(std::memory_order_acquire) != 0) {
+                std::unique_lock<std::mutex> lock(typed.mutex);
+                if (auto* policy = typed.template conflation_for<event_type>()) {
+                    const auto result = policy->post(typed, std::forward<EventType>(evt), lock);
+                    lock.unlock();
+                    if (result == post_result::posted) {
+                        typed.ready.notify_one();
+                    }
+                    return result;
+                }
+            }
+
+            auto& target = order == dispatch_order::per_type
+                               ? typed
+                               : *workers_[next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                                           workers_.size()];
+            // events that do not fit the inline buffer of the task are allocated from resource_
+            return target.push(task(std::allocator_arg, resource_,
+                                    [&bus = bus_, local_event = std::forward<EventType>(evt)]() {
+                                        bus.fire_event(local_event);
+                                    }));
+        }
+
+        /**
+         * @brief Block until every event posted before this call has been dispatched.
+         * @details Must not be called from a handler running on one of the workers.
+         */
+        void flush() {
+            std::vector<std::uint64_t> targets;
+            targets.reserve(workers_.size());
+            for (auto& w : workers_) {
+                std::lock_guard<std::mutex> lock(w->mutex);
+                targets.push_back(w->stats.posted);
+            }
+            for (std::size_t i = 0; i < workers_.size(); ++i) {
+                auto& w = *workers_[i];
+                std::unique_lock<std::mutex> lock(w.mutex);
+                w.idle.wait(lock, [&w, target = targets[i]]() { return w.completed >= target; });
+            }
+        }
+
+        /**
+         * @brief Stop accepting events, dispatch the events already queued and join the workers.
+         */
+        void shutdown() {
+            for (auto& w : workers_) {
+                {
+                    std::lock_guard<std::mutex> lock(w->mutex);
+                    w->stopping = true;
+                }
+                w->ready.notify_all();
+                w->space.notify_all();
+            }
+            for (auto& w : workers_) {
+                if (w->thread.joinable()) {
+                    w->thread.join();
+                }
+            }
+        }
+
+        /**
+         * @brief The number of worker threads.
+         */
+        [[nodiscard]] std::size_t worker_count() const noexcept { return workers_.size(); }
+
+        /**
+         * @brief Counters of the queue of every worker, indexed by worker.
+         */
+        [[nodiscard]] std::vector<async_queue_stats> queue_stats() const {
+            std::vector<async_queue_stats> result;
+            result.reserve(workers_.size());
+            for (const auto& w : workers_) {
+                std::lock_guard<std::mutex> lock(w->mutex);
+                result.push_back(w->stats);
+                result.back().queued = w->queue.size();
+            }
+            return result;
+        }
+
+      private:
+        using task = detail::inplace_handler<void()>;
+
+        struct worker;
+
+        struct conflation_base {
+            virtual ~conflation_base() = default;
+            // called with the lock of the worker held when its oldest queued event is discarded
+            virtual void drop_oldest() noexcept = 0;
+        };
+
+        template <typename EventType>
+        struct typed_conflation : conflation_base {
+            // called with the lock of the worker held
+            virtual post_result post(worker& target, EventType evt,
+                                     std::unique_lock<std::mutex>& lock) = 0;
+        };
+
+        template <typename EventType, typename KeyExtractor, typename Merge>
+        struct conflation final : typed_conflation<EventType> {
+            using key_type =
+                std::decay_t<std::invoke_result_t<const KeyExtractor&, const EventType&>>;
+
+            conflation(event_bus& target_bus, std::pmr::memory_resource* resource,
+                       KeyExtractor&& extractor, Merge&& merge_events)
+                : bus(target_bus),
+                  key_extractor(std::move(extractor)),
+                  merge(std::move(merge_events)),
+                  pending(resource),
+                  order(resource) {}
+
+            post_result post(worker& target, EventType evt,
+                             std::unique_lock<std::mutex>& lock) override {
+                if (target.stopping) {
+                    return post_result::stopped;
+                }
+                const auto key = std::invoke(key_extractor, std::as_const(evt));
+                if (merge_into_pending(key, evt)) {
+                    return post_result::posted;
+                }
+                if (const auto room = target.make_room(lock); room != post_result::posted) {
+                    return room;
+                }
+                // the key may have been queued while waiting for room
+                if (merge_into_pending(key, evt)) {
+                    return post_result::posted;
+                }
+
+                auto queued = pending.emplace(key, std::move(evt)).first;
+                try {
+                    order.push_back(key);
+                    try {
+                        target.enqueue({[this, &target]() { deliver(target); }, this});
+                    } catch (...) {
+                        order.pop_back();
+                        throw;
+                    }
+                } catch (...) {
+                    pending.erase(queued);
+                    throw;
+                }
+                return post_result::posted;
+            }
+
+            void drop_oldest() noexcept override {
+                pending.erase(order.front());
+                order.pop_front();
+            }
+
+            bool merge_into_pending(const key_type& key, EventType& evt) {
+                auto queued = pending.find(key);
+                if (queued == pending.end()) {
+                    return false;
+                }
+                merge(queued->second, std::move(evt));
+                return true;
+            }
+
+            void deliver(worker& target) {
+                std::unique_lock<std::mutex> lock(target.mutex);
+                // a worker runs the tasks of a type in the order they were queued
+                auto node = pending.extract(order.front());
+                order.pop_front();
+                lock.unlock();
+                // later events of the key are queued again from now on
+                bus.fire_event(node.mapped());
+            }
+
+            event_bus& bus;
+            KeyExtractor key_extractor;
+            Merge merge;
+            std::pmr::unordered_map<key_type, EventType> pending;
+            // keys in the order their tasks were queued
+            std::pmr::deque<key_type> order;
+        };
+
+        struct queued_task {
+            task run;
+            // set for the tasks of conflated events, which forget their key when discarded
+            conflation_base* conflated{nullptr};
+        };
+
+        struct worker {
+            worker(std::pmr::memory_resource* resource, const queue_options& options)
+                : queue(resource, options.capacity), overflow(options.overflow) {}
+
+            std::mutex mutex;
+            std::condition_variable ready;
+            std::condition_variable idle;
+            // only waited on by producers with overflow_policy::block
+            std::condition_variable space;
+            detail::ring_buffer<queued_task> queue;
+            overflow_policy overflow;
+            async_queue_stats stats;
+            std::uint64_t completed{0};
+            bool stopping{false};
+            std::thread thread;
+            // indexed by detail::type_id, only set for conflated types of this worker
+            std::vector<std::unique_ptr<conflation_base>> conflations;
+
+            post_result push(task&& new_task) {
+                post_result result;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    result = make_room(lock);
+                    if (result == post_result::posted) {
+                        enqueue({std::move(new_task)});
+                    }
+                }
+                if (result == post_result::posted) {
+                    ready.notify_one();
+                }
+                return result;
+            }
+
+            // called with the lock held, returns post_result::posted if one task can be queued
+            post_result make_room(std::unique_lock<std::mutex>& lock) {
+                if (stopping) {
+                    return post_result::stopped;
+                }
+                if (!queue.full()) {
+                    return post_result::posted;
+                }
+                switch (overflow) {
+                    case overflow_policy::block:
+                        space.wait(lock, [this]() { return stopping || !queue.full(); });
+                        return stopping ? post_result::stopped : post_result::posted;
+                    case overflow_policy::drop_oldest:
+                        drop_oldest();
+                        return post_result::posted;
+                    case overflow_policy::drop_newest:
+                        ++stats.dropped;
+                        return post_result::dropped;
+                    case overflow_policy::fail:
+                        break;
+                }
+                ++stats.rejected;
+                return post_result::queue_full;
+            }
+
+            // called with the lock held
+            void drop_oldest() noexcept {
+                auto oldest = queue.pop_front();
+                if (oldest.conflated) {
+                    oldest.conflated->drop_oldest();
+                }
+                ++stats.dropped;
+                // counts as done for flush()
+                ++completed;
+                idle.notify_all();
+            }
+
+            // called with the lock held
+            void enqueue(queued_task&& new_task) {
+                queue.push_back(std::move(new_task));
+                ++stats.posted;
+                stats.high_water = std::max(stats.high_water, queue.size());
+            }
+
+            // called with the lock held
+            template <typename EventType>
+            typed_conflation<EventType>* conflation_for() const noexcept {
+                const auto event_type = detail::type_id<EventType>();
+                if (event_type >= conflations.size()) {
+                    return nullptr;
+                }
+                return static_cast<typed_conflation<EventType>*>(conflations[event_type].get());
+            }
+        };
+
+        static void run(worker& w) {
+            std::unique_lock<std::mutex> lock(w.mutex);
+            while (true) {
+                w.ready.wait(lock, [&w]() { return w.stopping || !w.queue.empty(); });
+                if (w.queue.empty()) {
+                    // stopping and fully drained
+                    return;
+                }
+                auto next_task = std::move(w.queue.pop_front().run);
+                if (w.overflow == overflow_policy::block) {
+                    w.space.notify_one();
+                }
+                lock.unlock();
+                next_task();
+                // release the event outside of the lock
+                next_task = nullptr;
+                lock.lock();
+                ++w.completed;
+                w.idle.notify_all();
+            }
+        }
+
+        event_bus& bus_;
+        std::pmr::memory_resource* resource_;
+        std::vector<std::unique_ptr<worker>> workers_;
+        std::atomic<std::size_t> next_worker_{0};
+        std::atomic<std::size_t> conflated_types_{0};
+    };
+}  // namespace dp
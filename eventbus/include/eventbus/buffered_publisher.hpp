@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "detail/type_id.hpp"
+#include "event_bus.hpp"
+
+namespace dp {
+    /**
+     * @brief When the thread local buffers of a buffered_publisher are flushed.
+     */
+    struct publish_options {
+        /**
+         * @brief A thread flushes its own buffer once it holds this many events.
+         */
+        std::size_t batch_size{256};
+        /**
+         * @brief A background thread flushes all buffers at this interval, so events wait at most
+         * about this long. Zero disables the background thread, buffers are then only flushed
+         * at batch_size or by flush().
+         */
+        std::chrono::microseconds max_delay{std::chrono::milliseconds(1)};
+    };
+
+    /**
+     * @brief Publishes events to an event_bus in batches collected per producer thread.
+     * @details publish() only appends the event to a buffer owned by the calling thread, it does
+     * not touch the registration lock or the handler tables of the event_bus, which producer
+     * threads would otherwise contend on for every event. Buffers are dispatched with
+     * event_bus::fire_events, consecutive events of the same type in one call, so batch handlers
+     * receive them as one batch.
+     *
+     * Events of one producer thread are dispatched in the order they were published, events of
+     * different threads are not ordered. Handlers run on the thread that flushes the buffer: the
+     * producer when its buffer reaches publish_options::batch_size, the background thread, or the
+     * caller of flush(). Handlers must not call flush() themselves.
+     *
+     * The event_bus must outlive this object. Threads must stop publishing before it is
+     * destroyed, the destructor flushes the remaining events.
+     */
+    class buffered_publisher {
+      public:
+        /**
+         * @brief Create a publisher for the given event bus.
+         * @param bus The event bus whose handlers will be called.
+         * @param options When buffered events are flushed.
+         */
+        explicit buffered_publisher(event_bus& bus, publish_options options = {})
+            : bus_(bus), options_(options) {
+            if (options_.max_delay.count() > 0) {
+                flusher_ = std::thread([this]() { run_flusher(); });
+            }
+        }
+
+        buffered_publisher(const buffered_publisher&) = delete;
+        buffered_publisher& operator=(const buffered_publisher&) = delete;
+
+        ~buffered_publisher() {
+            if (flusher_.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(flusher_mutex_);
+                    stopping_ = true;
+                }
+                flusher_wakeup_.notify_one();
+                flusher_.join();
+            }
+            flush();
+        }
+
+        /**
+         * @brief Append an event to the buffer of the calling thread.
+         * @tparam EventType The event type
+         * @param evt The event, it is copied or moved into the buffer.
+         */
+        template <typename EventType,
+                  typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<EventType>>>>
+        void publish(EventType&& evt) {
+            auto& buffer = local_buffer();
+            bool full{false};
+            {
+                std::lock_guard<std::mutex> lock(buffer.mutex);
+                buffer.append(std::forward<EventType>(evt));
+                full = buffer.size >= options_.batch_size;
+            }
+            // events published by handlers while this thread flushes wait for the next flush
+            if (full && !flushing_on_this_thread()) {
+                // if another thread is flushing the buffer, one of the next events flushes it
+                std::unique_lock<std::mutex> flush_lock(buffer.flush_mutex, std::try_to_lock);
+                if (flush_lock.owns_lock()) {
+                    flush(buffer);
+                }
+            }
+        }
+
+        /**
+         * @brief Dispatch the buffered events of all threads and wait until they were handled.
+         */
+        void flush() {
+            for (auto* buffer : snapshot_buffers()) {
+                std::lock_guard<std::mutex> flush_lock(buffer->flush_mutex);
+                flush(*buffer);
+            }
+        }
+
+        /**
+         * @brief The number of events waiting in the buffers of all threads.
+         */
+        [[nodiscard]] std::size_t pending() const {
+            std::size_t count{0};
+            for (auto* buffer : snapshot_buffers()) {
+                std::lock_guard<std::mutex> lock(buffer->mutex);
+                count += buffer->size;
+            }
+            return count;
+        }
+
+      private:
+        struct segment_base {
+            explicit segment_base(detail::type_id_t type) : event_type(type) {}
+            virtual ~segment_base() = default;
+            virtual void fire(event_bus& bus) noexcept = 0;
+            virtual void clear() noexcept = 0;
+
+            detail::type_id_t event_type;
+        };
+
+        // consecutive events of one type, keeps its capacity when it is reused
+        template <typename EventType>
+        struct segment final : segment_base {
+            segment() : segment_base(detail::type_id<EventType>()) {}
+            void fire(event_bus& bus) noexcept override {
+                bus.fire_events(events.data(), events.size());
+            }
+            void clear() noexcept override { events.clear(); }
+
+            std::vector<EventType> events;
+        };
+
+        // on its own cache lines so the buffers of different threads do not false share
+        struct alignas(64) thread_buffer {
+            template <typename Event>
+            void append(Event&& evt) {
+                using EventType = std::decay_t<Event>;
+                const auto event_type = detail::type_id<EventType>();
+                if (segments.empty() || segments.back()->event_type != event_type) {
+                    segments.push_back(take_spare<EventType>(event_type));
+                }
+                static_cast<segment<EventType>*>(segments.back().get())
+                    ->events.push_back(std::forward<Event>(evt));
+                ++size;
+            }
+
+            template <typename EventType>
+            std::unique_ptr<segment_base> take_spare(detail::type_id_t event_type) {
+                if (event_type < spares.size() && spares[event_type]) {
+                    return std::move(spares[event_type]);
+                }
+                return std::make_unique<segment<EventType>>();
+            }
+
+            // locked by the owning thread for every publish, by other threads only to flush
+            std::mutex mutex;
+            std::vector<std::unique_ptr<segment_base>> segments;
+            // emptied segments, indexed by detail::type_id
+            std::vector<std::unique_ptr<segment_base>> spares;
+            std::size_t size{0};
+
+            // held while flushing, so the events of a thread are dispatched in order
+            std::mutex flush_mutex;
+            std::vector<std::unique_ptr<segment_base>> flushing;
+        };
+
+        // called with the flush_mutex of the buffer held
+        void flush(thread_buffer& buffer) {
+            {
+                std::lock_guard<std::mutex> lock(buffer.mutex);
+                if (buffer.size == 0) {
+                    return;
+                }
+                buffer.flushing.swap(buffer.segments);
+                buffer.size = 0;
+            }
+            flushing_on_this_thread() = true;
+            for (auto& flushed : buffer.flushing) {
+                flushed->fire(bus_);
+                flushed->clear();
+            }
+            flushing_on_this_thread() = false;
+
+            std::lock_guard<std::mutex> lock(buffer.mutex);
+            for (auto& flushed : buffer.flushing) {
+                const auto event_type = flushed->event_type;
+                if (buffer.spares.size() <= event_type) {
+                    buffer.spares.resize(event_type + 1);
+                }
+                if (!buffer.spares[event_type]) {
+                    buffer.spares[event_type] = std::move(flushed);
+                }
+            }
+            buffer.flushing.clear();
+        }
+
+        thread_buffer& local_buffer() {
+            struct cached_buffer {
+                // expires with the publisher, the entry is then dropped by the next prune
+                std::weak_ptr<thread_buffer> owner;
+                thread_buffer* buffer;
+            };
+            struct buffer_cache {
+                // ids are never reused, so entries of destroyed publishers are never matched
+                std::uint64_t last_id{~std::uint64_t{0}};
+                thread_buffer* last{nullptr};
+                std::unordered_map<std::uint64_t, cached_buffer> entries;
+                std::size_t prune_at{8};
+            };
+            thread_local buffer_cache cache;
+            if (cache.last_id == id_) {
+                return *cache.last;
+            }
+            if (const auto found = cache.entries.find(id_); found != cache.entries.end()) {
+                cache.last_id = id_;
+                cache.last = found->second.buffer;
+                return *cache.last;
+            }
+
+            if (cache.entries.size() >= cache.prune_at) {
+                // drop the entries of destroyed publishers, amortized O(1) per new publisher
+                for (auto entry = cache.entries.begin(); entry != cache.entries.end();) {
+                    entry = entry->second.owner.expired() ? cache.entries.erase(entry)
+                                                          : std::next(entry);
+                }
+                cache.prune_at = std::max<std::size_t>(8, cache.entries.size() * 2);
+            }
+            // not make_shared, the weak pointer of the cache would keep the storage alive
+            std::shared_ptr<thread_buffer> created(new thread_buffer());
+            cache.entries.emplace(id_, cached_buffer{created, created.get()});
+            cache.last_id = id_;
+            cache.last = created.get();
+            std::lock_guard<std::mutex> lock(buffers_mutex_);
+            buffers_.push_back(std::move(created));
+            return *buffers_.back();
+        }
+
+        // buffers are only destroyed with the publisher, so the pointers stay valid
+        std::vector<thread_buffer*> snapshot_buffers() const {
+            std::lock_guard<std::mutex> lock(buffers_mutex_);
+            std::vector<thread_buffer*> snapshot;
+            snapshot.reserve(buffers_.size());
+            for (const auto& buffer : buffers_) {
+                snapshot.push_back(buffer.get());
+            }
+            return snapshot;
+        }
+
+        void run_flusher() {
+            std::unique_lock<std::mutex> lock(flusher_mutex_);
+            while (!flusher_wakeup_.wait_for(lock, options_.max_delay,
+                                             [this]() { return stopping_; })) {
+                lock.unlock();
+                flush();
+                lock.lock();
+            }
+        }
+
+        static bool& flushing_on_this_thread() noexcept {
+            thread_local bool flushing{false};
+            return flushing;
+        }
+
+        static std::uint64_t next_id() noexcept {
+            static std::atomic<std::uint64_t> counter{0};
+            return counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        event_bus& bus_;
+        publish_options options_;
+        const std::uint64_t id_{next_id()};
+        mutable std::mutex buffers_mutex_;
+        std::vector<std::shared_ptr<thread_buffer>> buffers_;
+
+        std::mutex flusher_mutex_;
+        std::condition_variable flusher_wakeup_;
+        bool stopping_{false};
+        std::thread flusher_;
+    };
+}  // namespace dp
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dp {
+    namespace detail {
+        /**
+         * @brief Epoch based reclamation for data that is read without locks.
+         * @details Readers announce themselves in one of two epochs by incrementing a counter in a
+         * cache line padded stripe picked per thread, so concurrent readers on different threads
+         * do not write to the same memory. Writers retire objects instead of deleting them and
+         * call reclaim(), which frees the objects that were retired two epoch flips ago once no
+         * reader is left in the previous epoch. reclaim() never blocks.
+         *
+         * retire() and reclaim() must be serialized by the caller.
+         */
+        class epoch_reclaimer {
+          public:
+            static constexpr std::size_t stripe_count = 64;
+
+            class read_guard {
+              public:
+                read_guard(const read_guard&) = delete;
+                read_guard& operator=(const read_guard&) = delete;
+                ~read_guard() { counter_->fetch_sub(1, std::memory_order_release); }
+
+              private:
+                explicit read_guard(std::atomic<std::size_t>* counter) : counter_(counter) {}
+                std::atomic<std::size_t>* counter_;
+                friend class epoch_reclaimer;
+            };
+
+            /**
+             * @param resource The memory resource retired objects were allocated from. It is also
+             * used for the bookkeeping of retired objects.
+             */
+            explicit epoch_reclaimer(
+                std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+                : resource_(resource), retired_{retired_list(resource), retired_list(resource)} {}
+            epoch_reclaimer(const epoch_reclaimer&) = delete;
+            epoch_reclaimer& operator=(const epoch_reclaimer&) = delete;
+            ~epoch_reclaimer() {
+                for (auto& retired : retired_) {
+                    free_all(retired);
+                }
+            }
+
+            /**
+             * @brief Enter a read side critical section. Pointers to retired objects loaded while
+             * the returned guard is alive stay valid until it is destroyed.
+             */
+            [[nodiscard]] read_guard enter() noexcept {
+                const auto epoch = epoch_.load(std::memory_order_seq_cst);
+                auto* counter = &stripes_[stripe_index()].readers[epoch];
+                counter->fetch_add(1, std::memory_order_seq_cst);
+                return read_guard{counter};
+            }
+
+            /**
+             * @brief Hand over ownership of an object that readers may still be using. The object
+             * must have been allocated from the memory resource of this reclaimer.
+             */
+            template <typename T>
+            void retire(T* object) {
+                if (object) {
+                    retired_[epoch_.load(std::memory_order_relaxed)].push_back(
+                        {object, &destroy<std::remove_const_t<T>>});
+                }
+            }
+
+            /**
+             * @brief Free retired objects that can no longer be reached by any reader.
+             */
+            void reclaim() noexcept {
+                const auto current = epoch_.load(std::memory_order_relaxed);
+                const auto previous = current ^ 1U;
+                for (const auto& counters : stripes_) {
+                    if (counters.readers[previous].load(std::memory_order_seq_cst) != 0) {
+                        return;
+                    }
+                }
+                free_all(retired_[previous]);
+                epoch_.store(previous, std::memory_order_seq_cst);
+            }
+
+          private:
+            struct retired_object {
+                const void* object;
+                void (*deleter)(const void*, std::pmr::memory_resource*);
+            };
+            using retired_list = std::pmr::vector<retired_object>;
+
+            struct alignas(64) stripe {
+                std::array<std::atomic<std::size_t>, 2> readers{};
+            };
+
+            static std::size_t stripe_index() noexcept {
+                static std::atomic<std::size_t> next_index{0};
+                thread_local const std::size_t index =
+                    next_index.fetch_add(1, std::memory_order_relaxed) % stripe_count;
+                return index;
+            }
+
+            template <typename T>
+            static void destroy(const void* object, std::pmr::memory_resource* resource) {
+                auto* typed_object = static_cast<T*>(const_cast<void*>(object));
+                typed_object->~T();
+                std::pmr::polymorphic_allocator<T>(resource).deallocate(typed_object, 1);
+            }
+
+            void free_all(retired_list& retired) noexcept {
+                for (const auto& item : retired) {
+                    item.deleter(item.object, resource_);
+                }
+                retired.clear();
+            }
+
+            std::pmr::memory_resource* resource_;
+            std::atomic<unsigned> epoch_{0};
+            std::array<stripe, stripe_count> stripes_{};
+            std::array<retired_list, 2> retired_;
+        };
+    }  // namespace detail
+}  // namespace dp
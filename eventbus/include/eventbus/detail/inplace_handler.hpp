@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef EVENTBUS_HANDLER_INLINE_SIZE
+/**
+ * Size in bytes of the buffer event handlers are stored in without allocating. The default keeps
+ * a handler entry of dp::event_bus within a 64 byte cache line and fits a member function delegate
+ * (object pointer plus member function pointer) on all common ABIs.
+ */
+#    define EVENTBUS_HANDLER_INLINE_SIZE 40
+#endif
+
+namespace dp {
+    namespace detail {
+        template <typename Signature, std::size_t InlineSize = EVENTBUS_HANDLER_INLINE_SIZE>
+        class inplace_handler;
+
+        /**
+         * @brief A copyable, type erased callable with an inline buffer, used to store handlers.
+         * @details Callables that fit the buffer are stored inline and never allocate.
+         * Trivially copyable callables, such as a member function delegate or a lambda capturing
+         * a few pointers, are copied with a memcpy and need no destructor call. Larger callables
+         * are allocated from a memory resource, which only costs an allocation when the handler is
+         * registered.
+         * @tparam InlineSize Size of the inline buffer in bytes.
+         */
+        template <typename Return, typename... Args, std::size_t InlineSize>
+        class inplace_handler<Return(Args...), InlineSize> {
+            struct heap_storage {
+                void* object;
+                std::pmr::memory_resource* resource;
+            };
+            static_assert(InlineSize >= sizeof(heap_storage),
+                          "The inline buffer must fit two pointers.");
+
+          public:
+            template <typename Callable>
+            static constexpr bool stores_inline =
+                sizeof(Callable) <= InlineSize && alignof(Callable) <= alignof(void*) &&
+                std::is_nothrow_move_constructible_v<Callable>;
+
+            inplace_handler() noexcept = default;
+
+            template <typename Callable,
+                      typename = std::enable_if_t<
+                          !std::is_same_v<std::decay_t<Callable>, inplace_handler> &&
+                          std::is_invocable_r_v<Return, std::decay_t<Callable>&, Args...>>>
+            inplace_handler(Callable&& callable)  // NOLINT(google-explicit-constructor)
+                : inplace_handler(std::allocator_arg, std::pmr::get_default_resource(),
+                                  std::forward<Callable>(callable)) {}
+
+            /**
+             * @brief Construct a handler, allocating from the given resource if the callable
+             * does not fit the inline buffer.
+             */
+            template <typename Callable,
+                      typename = std::enable_if_t<
+                          !std::is_same_v<std::decay_t<Callable>, inplace_handler> &&
+                          std::is_invocable_r_v<Return, std::decay_t<Callable>&, Args...>>>
+            inplace_handler(std::allocator_arg_t, std::pmr::memory_resource* resource,
+                            Callable&& callable) {
+                using callable_type = std::decay_t<Callable>;
+                if constexpr (stores_inline<callable_type>) {
+                    ::new (static_cast<void*>(buffer_))
+                        callable_type(std::forward<Callable>(callable));
+                    invoke_ = &invoke_inline<callable_type>;
+                    if constexpr (!std::is_trivially_copyable_v<callable_type>) {
+                        ops_ = &inline_ops<callable_type>;
+                    }
+                } else {
+                    std::pmr::polymorphic_allocator<callable_type> allocator(resource);
+                    auto* object = allocator.allocate(1);
+                    try {
+                        ::new (static_cast<void*>(object))
+                            callable_type(std::forward<Callable>(callable));
+                    } catch (...) {
+                        allocator.deallocate(object, 1);
+                        throw;
+                    }
+                    ::new (static_cast<void*>(buffer_)) heap_storage{object, resource};
+                    invoke_ = &invoke_heap<callable_type>;
+                    ops_ = &heap_ops<callable_type>;
+                }
+            }
+
+            inplace_handler(const inplace_handler& other) { copy_from(other); }
+
+            inplace_handler(inplace_handler&& other) noexcept { move_from(other); }
+
+            inplace_handler& operator=(const inplace_handler& other) {
+                if (this != &other) {
+                    inplace_handler copy(other);
+                    reset();
+                    move_from(copy);
+                }
+                return *this;
+            }
+
+            inplace_handler& operator=(inplace_handler&& other) noexcept {
+                if (this != &other) {
+                    reset();
+                    move_from(other);
+                }
+                return *this;
+            }
+
+            inplace_handler& operator=(std::nullptr_t) noexcept {
+                reset();
+                return *this;
+            }
+
+            ~inplace_handler() { reset(); }
+
+            explicit operator bool() const noexcept { return invoke_ != nullptr; }
+
+            Return operator()(Args... args) const {
+                return invoke_(const_cast<unsigned char*>(buffer_), std::forward<Args>(args)...);
+            }
+
+          private:
+            struct operations {
+                void (*copy)(void* destination, const void* source);
+                void (*move)(void* destination, void* source) noexcept;
+                void (*destroy)(void* storage) noexcept;
+            };
+
+            template <typename Callable>
+            static Return invoke_inline(void* storage, Args... args) {
+                return std::invoke(*static_cast<Callable*>(storage), std::forward<Args>(args)...);
+            }
+
+            template <typename Callable>
+            static Return invoke_heap(void* storage, Args... args) {
+                auto* object = static_cast<heap_storage*>(storage)->object;
+                return std::invoke(*static_cast<Callable*>(object), std::forward<Args>(args)...);
+            }
+
+            template <typename Callable>
+            static constexpr operations inline_ops{
+                [](void* destination, const void* source) {
+                    ::new (destination) Callable(*static_cast<const Callable*>(source));
+                },
+                [](void* destination, void* source) noexcept {
+                    ::new (destination) Callable(std::move(*static_cast<Callable*>(source)));
+                    static_cast<Callable*>(source)->~Callable();
+                },
+                [](void* storage) noexcept { static_cast<Callable*>(storage)->~Callable(); }};
+
+            template <typename Callable>
+            static constexpr operations heap_ops{
+                [](void* destination, const void* source) {
+                    const auto& from = *static_cast<const heap_storage*>(source);
+                    std::pmr::polymorphic_allocator<Callable> allocator(from.resource);
+                    auto* object = allocator.allocate(1);
+                    try {
+                        ::new (static_cast<void*>(object))
+                            Callable(*static_cast<const Callable*>(from.object));
+                    } catch (...) {
+                        allocator.deallocate(object, 1);
+                        throw;
+                    }
+                    ::new (destination) heap_storage{object, from.resource};
+                },
+                [](void* destination, void* source) noexcept {
+                    ::new (destination) heap_storage(*static_cast<heap_storage*>(source));
+                },
+                [](void* storage) noexcept {
+                    const auto& from = *static_cast<heap_storage*>(storage);
+                    auto* object = static_cast<Callable*>(from.object);
+                    object->~Callable();
+                    std::pmr::polymorphic_allocator<Callable>(from.resource).deallocate(object, 1);
+                }};
+
+            void copy_from(const inplace_handler& other) {
+                if (other.ops_) {
+                    other.ops_->copy(buffer_, other.buffer_);
+                } else {
+                    std::memcpy(buffer_, other.buffer_, InlineSize);
+                }
+                invoke_ = other.invoke_;
+                ops_ = other.ops_;
+            }
+
+            void move_from(inplace_handler& other) noexcept {
+                if (other.ops_) {
+                    other.ops_->move(buffer_, other.buffer_);
+                } else {
+                    std::memcpy(buffer_, other.buffer_, InlineSize);
+                }
+                invoke_ = std::exchange(other.invoke_, nullptr);
+                ops_ = std::exchange(other.ops_, nullptr);
+            }
+
+            void reset() noexcept {
+                if (ops_) {
+                    ops_->destroy(buffer_);
+                }
+                invoke_ = nullptr;
+                ops_ = nullptr;
+            }
+
+            Return (*invoke_)(void*, Args...){nullptr};
+            const operations* ops_{nullptr};
+            alignas(void*) unsigned char buffer_[InlineSize]{};
+        };
+    }  // namespace detail
+}  // namespace dp
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace dp {
+    namespace detail {
+        /**
+         * @brief A FIFO queue on a contiguous circular buffer, not thread safe.
+         * @details A bounded buffer allocates all of its slots up front and never allocates
+         * again, pushing to a full bounded buffer is a precondition violation. An unbounded buffer
+         * doubles its capacity when it is full.
+         * @tparam T Element type, must be default constructible and nothrow move assignable.
+         */
+        template <typename T>
+        class ring_buffer {
+          public:
+            /**
+             * @param resource Memory resource for the slots.
+             * @param capacity Fixed number of slots, 0 for an unbounded buffer.
+             */
+            explicit ring_buffer(std::pmr::memory_resource* resource, std::size_t capacity = 0)
+                : slots_(capacity, resource), bounded_(capacity != 0) {}
+
+            [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+            [[nodiscard]] std::size_t size() const noexcept { return size_; }
+            [[nodiscard]] bool full() const noexcept { return bounded_ && size_ == slots_.size(); }
+
+            /**
+             * @brief The fixed capacity, 0 if the buffer is unbounded.
+             */
+            [[nodiscard]] std::size_t capacity() const noexcept {
+                return bounded_ ? slots_.size() : 0;
+            }
+
+            void push_back(T&& value) {
+                assert(!full());
+                if (size_ == slots_.size()) {
+                    grow();
+                }
+                slots_[(head_ + size_) % slots_.size()] = std::move(value);
+                ++size_;
+            }
+
+            T pop_front() noexcept {
+                assert(!empty());
+                T value = std::move(slots_[head_]);
+                head_ = (head_ + 1) % slots_.size();
+                --size_;
+                return value;
+            }
+
+          private:
+            void grow() {
+                std::pmr::vector<T> larger(std::max<std::size_t>(16, slots_.size() * 2),
+                                           slots_.get_allocator());
+                for (std::size_t i = 0; i < size_; ++i) {
+                    larger[i] = std::move(slots_[(head_ + i) % slots_.size()]);
+                }
+                slots_.swap(larger);
+                head_ = 0;
+            }
+
+            std::pmr::vector<T> slots_;
+            std::size_t head_{0};
+            std::size_t size_{0};
+            bool bounded_;
+        };
+    }  // namespace detail
+}  // namespace dp
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace dp {
+    /**
+     * @brief Identifies an event type across processes and program runs, see shared_memory_bus
+     * and event_journal.
+     * @details Defaults to a hash of the name of the type as spelled by the compiler, which
+     * matches between programs built with the same compiler. Specialize it with a
+     * `static constexpr std::uint64_t value` to pin the tag of a type, for example when the
+     * programs are built by different compilers or a type is renamed.
+     */
+    template <typename EventType, typename = void>
+    struct shared_event_tag;
+
+    namespace detail {
+        constexpr std::uint64_t fnv1a(std::string_view text) noexcept {
+            std::uint64_t hash = 14695981039346656037ull;
+            for (const auto character : text) {
+                hash = (hash ^ static_cast<unsigned char>(character)) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        template <typename EventType>
+        constexpr std::uint64_t type_name_hash() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+            return fnv1a(__FUNCSIG__);
+#else
+            return fnv1a(__PRETTY_FUNCTION__);
+#endif
+        }
+
+        template <typename EventType, typename = void>
+        struct has_custom_tag : std::false_type {};
+
+        template <typename EventType>
+        struct has_custom_tag<EventType,
+                              std::void_t<decltype(shared_event_tag<EventType>::value)>>
+            : std::true_type {};
+
+        template <typename EventType>
+        constexpr std::uint64_t shared_tag() noexcept {
+            if constexpr (has_custom_tag<EventType>::value) {
+                return shared_event_tag<EventType>::value;
+            } else {
+                return type_name_hash<EventType>();
+            }
+        }
+    }  // namespace detail
+}  // namespace dp
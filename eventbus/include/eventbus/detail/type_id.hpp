@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace dp {
+    namespace detail {
+        /**
+         * @brief Dense, process wide identifier for an event type.
+         * @details Ids are handed out from 0 in the order types are first used, so they can be used
+         * to index directly into per type tables.
+         */
+        using type_id_t = std::size_t;
+
+        inline type_id_t next_type_id() noexcept {
+            static std::atomic<type_id_t> counter{0};
+            return counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        template <typename T>
+        struct type_id_holder {
+            // function local static so ids are valid even when used during static initialization
+            static type_id_t get() noexcept {
+                static const type_id_t id = next_type_id();
+                return id;
+            }
+        };
+
+        /**
+         * @brief Get the dense type id of the given type. cv-qualifiers and references are ignored.
+         */
+        template <typename T>
+        type_id_t type_id() noexcept {
+            return type_id_holder<std::remove_cv_t<std::remove_reference_t<T>>>::get();
+        }
+    }  // namespace detail
+}  // namespace dp
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "detail/type_id.hpp"
+#include "registration_handle.hpp"
+
+#ifndef EVENTBUS_ENABLE_INSTRUMENTATION
+/**
+ * Set to 1 to record dispatch statistics in dp::event_bus, see event_bus::stats(). When 0 (the
+ * default) no statistics are kept and dispatch is not timed at all. Every translation unit of a
+ * program must use the same value.
+ */
+#    define EVENTBUS_ENABLE_INSTRUMENTATION 0
+#endif
+
+namespace dp {
+    /**
+     * @brief Histogram of durations with power of two buckets in nanoseconds.
+     * @details Bucket 0 counts durations below 2ns, bucket i durations in [2^i, 2^(i+1)) ns and
+     * the last bucket everything from 2^(bucket_count - 1) ns on.
+     */
+    struct latency_histogram {
+        static constexpr std::size_t bucket_count = 32;
+
+        std::array<std::uint64_t, bucket_count> buckets{};
+        std::uint64_t total_ns{0};
+
+        /**
+         * @brief The number of recorded durations.
+         */
+        [[nodiscard]] std::uint64_t count() const noexcept {
+            std::uint64_t total{0};
+            for (const auto bucket : buckets) {
+                total += bucket;
+            }
+            return total;
+        }
+
+        /**
+         * @brief Upper bound in nanoseconds of the bucket that holds the given quantile, for
+         * instance 0.99 for the p99 latency. Returns 0 if nothing was recorded.
+         */
+        [[nodiscard]] std::uint64_t percentile_ns(double quantile) const noexcept {
+            const auto total = count();
+            if (total == 0) {
+                return 0;
+            }
+            const auto rank =
+                static_cast<std::uint64_t>(quantile * static_cast<double>(total - 1));
+            std::uint64_t seen{0};
+            for (std::size_t i = 0; i < bucket_count; ++i) {
+                seen += buckets[i];
+                if (seen > rank) {
+                    return std::uint64_t{2} << i;
+                }
+            }
+            return std::uint64_t{2} << (bucket_count - 1);
+        }
+    };
+
+    /**
+     * @brief Statistics of a single registered handler.
+     */
+    struct handler_stats {
+        /// Matches handler_registration::handle() of the registration.
+        registration_handle handle;
+        /// Number of calls, a call delivers one event or one batch.
+        std::uint64_t calls{0};
+        /// Number of calls that ended with an exception.
+        std::uint64_t exceptions{0};
+        latency_histogram latency;
+    };
+
+    /**
+     * @brief Statistics of all handlers of one event type.
+     */
+    struct event_type_stats {
+        /// Matches registration_handle::event_type of registrations for this type.
+        detail::type_id_t event_type{0};
+        /// Number of fire_event() and fire_events() calls.
+        std::uint64_t fires{0};
+        /// Number of events, every event of a batch counts.
+        std::uint64_t events{0};
+        /// Time taken to call all handlers, per fire.
+        latency_histogram dispatch_latency;
+        /// Currently registered handlers, in dispatch order.
+        std::vector<handler_stats> handlers;
+    };
+
+    /**
+     * @brief A snapshot of the dispatch statistics of an event_bus.
+     */
+    struct event_bus_stats {
+        /// Time spent waiting for the registration lock in shared mode, which fire_event takes in
+        /// dispatch_mode::locked.
+        latency_histogram shared_lock_wait;
+        /// Time registration and removal waited for the registration lock in exclusive mode.
+        latency_histogram exclusive_lock_wait;
+        /// Event types that have handlers or were fired while they had handlers.
+        std::vector<event_type_stats> event_types;
+    };
+
+    namespace detail {
+        /**
+         * @brief A latency_histogram that can be recorded to concurrently.
+         */
+        class atomic_histogram {
+          public:
+            void record(std::chrono::steady_clock::duration duration) noexcept {
+                const auto ns = static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+                std::size_t bucket{0};
+                while (bucket + 1 < latency_histogram::bucket_count && (ns >> (bucket + 1)) != 0) {
+                    ++bucket;
+                }
+                buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+                total_ns_.fetch_add(ns, std::memory_order_relaxed);
+            }
+
+            [[nodiscard]] latency_histogram snapshot() const noexcept {
+                latency_histogram histogram;
+                for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i) {
+                    histogram.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+                }
+                histogram.total_ns = total_ns_.load(std::memory_order_relaxed);
+                return histogram;
+            }
+
+          private:
+            std::array<std::atomic<std::uint64_t>, latency_histogram::bucket_count> buckets_{};
+            std::atomic<std::uint64_t> total_ns_{0};
+        };
+
+        struct handler_counters {
+            std::atomic<std::uint64_t> calls{0};
+            std::atomic<std::uint64_t> exceptions{0};
+            atomic_histogram latency;
+        };
+
+        struct event_type_counters {
+            std::atomic<std::uint64_t> fires{0};
+            std::atomic<std::uint64_t> events{0};
+            atomic_histogram dispatch_latency;
+        };
+    }  // namespace detail
+}  // namespace dp
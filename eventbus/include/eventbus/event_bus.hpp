@@ -1,51 +1,75 @@
 #pragma once
 
-#include <any>
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <thread>
-#include <typeindex>
-#include <unordered_map>
+#include <tuple>
 #include <utility>
+#include <vector>
 
+#include "detail/epoch_reclaimer.hpp"
 #include "detail/function_traits.hpp"
+#include "detail/inplace_handler.hpp"
+#include "detail/type_id.hpp"
+#include "dispatch_stats.hpp"
+#include "next_event.hpp"
+#include "registration_handle.hpp"
+#include "work_stealing_pool.hpp"
 
 namespace dp {
-    class event_bus;
-
     /**
-     * @brief A registration handle for a particular handler of an event type.
-     * @details This class is move constructible only. It also assumed that the lifespan of this
-     * object will be as long or shorter than that of the event bus. This class is move
-     * constructible for that reason, but there are still some cases where you can run into life
-     * time issues.
+     * @brief A read only view of a contiguous batch of events.
+     * @tparam EventType The event type
      */
-    class handler_registration {
-        const void* handle_{nullptr};
-        dp::event_bus* event_bus_{nullptr};
-
+    template <typename EventType>
+    class event_batch {
       public:
-        handler_registration(const handler_registration& other) = delete;
-        handler_registration(handler_registration&& other) noexcept;
-        handler_registration& operator=(const handler_registration& other) = delete;
-        handler_registration& operator=(handler_registration&& other) noexcept;
-        ~handler_registration();
+        constexpr event_batch(const EventType* events, std::size_t count) noexcept
+            : events_(events), count_(count) {}
+
+        [[nodiscard]] constexpr const EventType* data() const noexcept { return events_; }
+        [[nodiscard]] constexpr std::size_t size() const noexcept { return count_; }
+        [[nodiscard]] constexpr bool empty() const noexcept { return count_ == 0; }
+        [[nodiscard]] constexpr const EventType* begin() const noexcept { return events_; }
+        [[nodiscard]] constexpr const EventType* end() const noexcept { return events_ + count_; }
+        constexpr const EventType& operator[](std::size_t index) const noexcept {
+            return events_[index];
+        }
 
+      private:
+        const EventType* events_;
+        std::size_t count_;
+    };
+
+    /**
+     * @brief Controls how event_bus::fire_event synchronizes with handler registration.
+     */
+    enum class dispatch_mode {
         /**
-         * @brief Pointer to the underlying handle.
+         * @brief fire_event holds a shared lock while dispatching. Removing a handler waits for
+         * dispatches that are in flight, so a handler is never called after remove_handler()
+         * returns. Handlers may register and remove handlers, those changes are applied once the
+         * dispatch that called the handler is done.
          */
-        [[nodiscard]] const void* handle() const;
-
+        locked,
         /**
-         * @brief Unregister this handler from the event bus.
+         * @brief fire_event takes no locks and reads an immutable, atomically published snapshot
+         * of the handlers. Registration and removal never wait for dispatches, but a dispatch
+         * that is already in flight may still call a handler after it was removed.
          */
-        void unregister() noexcept;
-
-      protected:
-        handler_registration(const void* handle, dp::event_bus* bus);
-        friend class event_bus;
+        lock_free
     };
 
     /**
@@ -53,43 +77,157 @@ namespace dp {
      */
     class event_bus {
       public:
-        event_bus() = default;
+        /**
+         * @brief Create an event bus.
+         * @param mode How fire_event synchronizes with handler registration.
+         * @param resource Memory resource for the handler storage. Allocations from it are
+         * serialized by the bus, so it does not need to be thread safe. It must outlive the event
+         * bus.
+         */
+        explicit event_bus(dispatch_mode mode = dispatch_mode::locked,
+                           std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : mode_(mode),
+              resource_(resource),
+              reclaimer_(resource),
+              tables_(resource),
+              slots_(resource),
+              free_slots_(resource) {}
+
+        /**
+         * @brief Create an event bus in dispatch_mode::locked that allocates its handler storage
+         * from the given memory resource.
+         */
+        explicit event_bus(std::pmr::memory_resource* resource)
+            : event_bus(dispatch_mode::locked, resource) {}
+
+        event_bus(const event_bus&) = delete;
+        event_bus& operator=(const event_bus&) = delete;
+        ~event_bus() {
+            const auto destroy_handlers = [this](handler_table& table) {
+                auto* handlers = table.handlers.load(std::memory_order_relaxed);
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+                release_counters(handlers);
+#endif
+                destroy(handlers);
+            };
+            for (auto* table : tables_) {
+                destroy_handlers(*table);
+                for (auto* extractor : table->extractors) {
+                    destroy_handlers(extractor->table);
+                    destroy(extractor);
+                }
+                destroy(table->resolved.load(std::memory_order_relaxed));
+                destroy(table->keys.load(std::memory_order_relaxed));
+                if (auto* sticky = table->sticky.load(std::memory_order_relaxed)) {
+                    sticky->destroy(resource_);
+                }
+                destroy(table);
+            }
+            destroy(directory_.load(std::memory_order_relaxed));
+        }
 
         /**
          * @brief Register an event handler for a given event type.
          * @tparam EventType The event type
+         * @details Handlers with a higher priority are called first, handlers with the same
+         * priority in the order they were registered. A handler that returns `bool` consumes the
+         * event by returning true, the handlers after it are then not called for that event.
+         * Handlers registered by a handler are not called for the event being dispatched.
+         * Priorities only order the handlers without a key among each other, handlers registered
+         * with a key always run after them.
          * @tparam EventHandler The invocable event handler type.
          * @param handler A callable handler of the event type. Can accept the event as param or
-         * take no params.
+         * take no params. Can return void or bool.
+         * @param priority The priority of the handler, 0 by default.
          * @return A handler_registration instance for the given handler.
          */
         template <typename EventType, typename EventHandler,
                   typename = std::enable_if_t<std::is_invocable_v<EventHandler> ||
-                                              std::is_invocable_v<EventHandler, EventType>>>
-        [[nodiscard]] handler_registration register_handler(EventHandler&& handler) {
+                                              std::is_invocable_v<EventHandler, const EventType&>>>
+        [[nodiscard]] handler_registration register_handler(EventHandler&& handler,
+                                                            int priority = 0) {
             using traits = detail::function_traits<EventHandler>;
-            const auto type_idx = std::type_index(typeid(EventType));
-            const void* handle;
+            constexpr auto consumes = std::is_same_v<typename traits::result_type, bool>;
             // check if the function takes any arguments.
             if constexpr (traits::arity == 0) {
-                safe_unique_registrations_access([&]() {
-                    auto it = handler_registrations_.emplace(
-                        type_idx,
-                        [handler = std::forward<EventHandler>(handler)](auto) { handler(); });
-
-                    handle = static_cast<const void*>(&(it->second));
-                });
+                return add_handler<EventType>(
+                    [handler = std::forward<EventHandler>(handler)](
+                        const void*, std::size_t count) mutable {
+                        return call_for_each(count, [&handler](std::size_t) { return handler(); });
+                    },
+                    priority, consumes);
             } else {
-                safe_unique_registrations_access([&]() {
-                    auto it = handler_registrations_.emplace(
-                        type_idx, [func = std::forward<EventHandler>(handler)](auto value) {
-                            func(std::any_cast<EventType>(value));
-                        });
-
-                    handle = static_cast<const void*>(&(it->second));
-                });
+                return add_handler<EventType>(
+                    [func = std::forward<EventHandler>(handler)](const void* events,
+                                                                 std::size_t count) mutable {
+                        const auto* first = static_cast<const EventType*>(events);
+                        return call_for_each(
+                            count, [&func, first](std::size_t i) { return func(first[i]); });
+                    },
+                    priority, consumes);
             }
-            return {handle, this};
+        }
+
+        /**
+         * @brief Register an event handler that is only called for events with a given key.
+         * @details The bus keeps a hash index per event type and key extractor, so firing an
+         * event only calls the keyed handlers whose key equals the key of the event, no matter how
+         * many keyed handlers there are. Keyed handlers run after all handlers without a key,
+         * whatever their priorities, one key extractor after the other. They are called one event
+         * at a time, also for fire_events(), and are not called for events of derived types (see
+         * declare_base()).
+         *
+         * Handlers are grouped by the type of the key extractor and, for function and member
+         * pointers, its value. Key extractors of the same type must therefore compute the same
+         * key, which is always true for member pointers and lambdas without captures.
+         * @tparam EventType The event type
+         * @tparam KeyExtractor A member pointer or callable that returns the key of an event.
+         * The key type must be hashable with std::hash and equality comparable.
+         * @tparam Key A type the key type can be constructed from.
+         * @tparam EventHandler The invocable event handler type.
+         * @param extract_key Extracts the key from an event, for example `&order::symbol`.
+         * @param key The key events must have for the handler to be called.
+         * @param handler A callable handler of the event type, as for the unkeyed overload.
+         * @param priority The priority of the handler among the keyed handlers of the same key
+         * extractor, 0 by default. A keyed handler that consumes an event only stops the keyed
+         * handlers after it, the handlers without a key were already called.
+         * @return A handler_registration instance for the given handler.
+         */
+        template <typename EventType, typename KeyExtractor, typename Key, typename EventHandler,
+                  typename = std::enable_if_t<
+                      std::is_invocable_v<std::decay_t<KeyExtractor>&, const EventType&> &&
+                      (std::is_invocable_v<EventHandler> ||
+                       std::is_invocable_v<EventHandler, const EventType&>)>>
+        [[nodiscard]] handler_registration register_handler(KeyExtractor&& extract_key,
+                                                            Key&& key, EventHandler&& handler,
+                                                            int priority = 0) {
+            using extractor_type = std::decay_t<KeyExtractor>;
+            using key_type =
+                std::decay_t<std::invoke_result_t<extractor_type&, const EventType&>>;
+            using traits = detail::function_traits<EventHandler>;
+            constexpr auto consumes = std::is_same_v<typename traits::result_type, bool>;
+
+            extractor_type extractor(std::forward<KeyExtractor>(extract_key));
+            key_type bound_key(std::forward<Key>(key));
+            const auto key_hash = std::hash<key_type>{}(bound_key);
+            return add_handler<EventType>(
+                [extractor, bound_key = std::move(bound_key),
+                 func = std::forward<EventHandler>(handler)](const void* events,
+                                                             std::size_t) mutable {
+                    // keyed handlers get one event at a time. The hash matched, the key may not.
+                    const auto& evt = *static_cast<const EventType*>(events);
+                    if (!(std::invoke(extractor, evt) == bound_key)) {
+                        return false;
+                    }
+                    return call_for_each(1, [&func, &evt](std::size_t) {
+                        if constexpr (traits::arity == 0) {
+                            return func();
+                        } else {
+                            return func(evt);
+                        }
+                    });
+                },
+                priority, consumes, std::move(extractor), key_hash);
         }
 
         /**
@@ -99,77 +237,303 @@ namespace dp {
          * @tparam MemberFunction Event handler member function
          * @param class_instance Instance of ClassType that will handle the event.
          * @param function Pointer to the MemberFunction of the ClassType.
+         * @param priority The priority of the handler, 0 by default.
          * @return A handler_registration instance for the given handler.
          */
-        template <typename EventType, typename ClassType, typename MemberFunction>
+        template <typename EventType, typename ClassType, typename MemberFunction,
+                  typename = std::enable_if_t<
+                      std::is_member_function_pointer_v<std::decay_t<MemberFunction>>>>
         [[nodiscard]] handler_registration register_handler(ClassType* class_instance,
-                                                            MemberFunction&& function) noexcept {
+                                                            MemberFunction&& function,
+                                                            int priority = 0) noexcept {
             using traits = detail::function_traits<MemberFunction>;
             static_assert(std::is_same_v<ClassType, std::decay_t<typename traits::owner_type>>,
                           "Member function pointer must match instance type.");
-
-            const auto type_idx = std::type_index(typeid(EventType));
-            const void* handle;
+            constexpr auto consumes = std::is_same_v<typename traits::result_type, bool>;
 
             if constexpr (traits::arity == 0) {
-                safe_unique_registrations_access([&]() {
-                    auto it = handler_registrations_.emplace(
-                        type_idx,
-                        [class_instance, function](auto) { (class_instance->*function)(); });
-
-                    handle = static_cast<const void*>(&(it->second));
-                });
-            } else {
-                safe_unique_registrations_access([&]() {
-                    auto it = handler_registrations_.emplace(
-                        type_idx, [class_instance, function](auto value) {
-                            (class_instance->*function)(std::any_cast<EventType>(value));
+                return add_handler<EventType>(
+                    [class_instance, function](const void*, std::size_t count) {
+                        return call_for_each(count, [class_instance, function](std::size_t) {
+                            return (class_instance->*function)();
                         });
-
-                    handle = static_cast<const void*>(&(it->second));
-                });
+                    },
+                    priority, consumes);
+            } else {
+                return add_handler<EventType>(
+                    [class_instance, function](const void* events, std::size_t count) {
+                        const auto* first = static_cast<const EventType*>(events);
+                        return call_for_each(
+                            count, [class_instance, function, first](std::size_t i) {
+                                return (class_instance->*function)(first[i]);
+                            });
+                    },
+                    priority, consumes);
             }
-            return {handle, this};
+        }
+
+        /**
+         * @brief Register a handler that receives events in batches.
+         * @details The handler is called once per fire_event() with a batch of one event and once
+         * per fire_events() with the whole batch. If handlers that can consume events are
+         * registered for the event type, events are dispatched one at a time and batch handlers
+         * receive batches of one event.
+         * @tparam EventType The event type
+         * @tparam BatchHandler The invocable handler type.
+         * @param handler A callable that accepts an event_batch<EventType>.
+         * @param priority The priority of the handler, 0 by default.
+         * @return A handler_registration instance for the given handler.
+         */
+        template <typename EventType, typename BatchHandler,
+                  typename = std::enable_if_t<
+                      std::is_invocable_v<BatchHandler, event_batch<std::decay_t<EventType>>>>>
+        [[nodiscard]] handler_registration register_batch_handler(BatchHandler&& handler,
+                                                                  int priority = 0) {
+            return add_handler<EventType>(
+                [func = std::forward<BatchHandler>(handler)](const void* events,
+                                                             std::size_t count) mutable {
+                    func(event_batch<std::decay_t<EventType>>{
+                        static_cast<const std::decay_t<EventType>*>(events), count});
+                    return false;
+                },
+                priority, false);
         }
 
         /**
          * @brief Fire an event to notify event handlers.
+         * @details The event is not copied. Every handler receives a `const EventType&` to the
+         * same object, handlers that take the event by value receive their own copy.
          * @tparam EventType The event type
          * @param evt The event to pass to all event handlers.
          */
-        template <typename EventType, typename = std::enable_if_t<!std::is_pointer_v<EventType>>>
+        template <typename EventType,
+                  typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<EventType>>>>
         void fire_event(EventType&& evt) noexcept {
-            safe_shared_registrations_access([this, local_event = std::forward<EventType>(evt)]() {
-                // only call the functions we need to
-                for (auto [begin_evt_id, end_evt_id] =
-                         handler_registrations_.equal_range(std::type_index(typeid(EventType)));
-                     begin_evt_id != end_evt_id; ++begin_evt_id) {
-                    begin_evt_id->second(local_event);
+            dispatch_guarded(detail::type_id<EventType>(),
+                             static_cast<const void*>(std::addressof(evt)), 1,
+                             sizeof(std::decay_t<EventType>));
+        }
+
+        /**
+         * @brief Fire a batch of events of the same type.
+         * @details The handlers are looked up once for the whole batch. Each handler is called
+         * for every event of the batch, in order, before the next handler runs. Batch handlers
+         * receive the whole batch at once. If a handler of the event type can consume events,
+         * the events are instead dispatched one after the other as if fired individually.
+         * @tparam EventType The event type
+         * @param events Pointer to the first of `count` contiguous events.
+         * @param count The number of events.
+         */
+        template <typename EventType>
+        void fire_events(const EventType* events, std::size_t count) noexcept {
+            if (count == 0) {
+                return;
+            }
+            dispatch_guarded(detail::type_id<EventType>(), static_cast<const void*>(events),
+                             count, sizeof(EventType));
+        }
+
+        /**
+         * @brief Fire all events of a contiguous container, such as a std::vector or std::array.
+         * @see fire_events(const EventType*, std::size_t)
+         */
+        template <typename Container,
+                  typename = decltype(std::data(std::declval<const Container&>()))>
+        void fire_events(const Container& events) noexcept {
+            fire_events(std::data(events), std::size(events));
+        }
+
+        /**
+         * @brief Fire an event and call its handlers in parallel on a thread pool.
+         * @details The handlers are split into chunks that the calling thread and the workers
+         * of the pool take turns claiming, so the calling thread helps and returns once every
+         * handler has returned. The event is not copied, all handlers receive a reference to
+         * the same object. Handlers that can consume events, handlers of base types (see
+         * declare_base()) and small handler lists are dispatched on the calling thread as by
+         * fire_event. Keyed handlers are called on the calling thread after the others.
+         * @tparam EventType The event type
+         * @param evt The event to pass to all event handlers.
+         * @param pool The pool to call the handlers on.
+         */
+        template <typename EventType,
+                  typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<EventType>>>>
+        void fire_event_parallel(EventType&& evt, work_stealing_pool& pool) noexcept {
+            dispatch_guarded(detail::type_id<EventType>(),
+                             static_cast<const void*>(std::addressof(evt)), 1,
+                             sizeof(std::decay_t<EventType>), &pool);
+        }
+
+        /**
+         * @brief Fire an event on a thread pool without waiting for its handlers.
+         * @details The event is copied or moved once, then dispatched by a worker of the pool
+         * as by fire_event_parallel(). The event bus and the pool must outlive the dispatch.
+         * @tparam EventType The event type
+         * @param evt The event to pass to all event handlers.
+         * @param pool The pool to call the handlers on.
+         * @return A token that is ready once all handlers have returned.
+         */
+        template <typename EventType,
+                  typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<EventType>>>>
+        [[nodiscard]] completion_token fire_event_async(EventType&& evt,
+                                                        work_stealing_pool& pool) {
+            using event_type = std::decay_t<EventType>;
+            auto state = std::make_shared<async_fire<event_type>>(std::forward<EventType>(evt));
+            pool.submit([this, state, pool_ptr = &pool]() {
+                dispatch_guarded(detail::type_id<event_type>(),
+                                 static_cast<const void*>(std::addressof(state->event)), 1,
+                                 sizeof(event_type), pool_ptr);
+                state->complete();
+            });
+            return completion_token(std::move(state));
+        }
+
+        /**
+         * @brief Call the handlers of an event type in parallel whenever it is fired.
+         * @details fire_event and fire_events then dispatch single events of the type as
+         * fire_event_parallel() does. Batches are still dispatched on the calling thread.
+         * @tparam EventType The event type
+         * @param pool The pool to call the handlers on, nullptr to dispatch on the calling
+         * thread again. It must outlive the event bus or be reset first.
+         */
+        template <typename EventType>
+        void dispatch_in_parallel(work_stealing_pool* pool) {
+            const auto configure = [this, pool]() {
+                table_for(detail::type_id<std::decay_t<EventType>>())
+                    .parallel.store(pool, std::memory_order_seq_cst);
+            };
+            if (auto* scope = current_dispatch()) {
+                scope->mutations.emplace_back(configure);
+            } else {
+                safe_unique_registrations_access(configure);
+            }
+        }
+
+        /**
+         * @brief Keep the most recent event of a type and deliver it to handlers that register
+         * later.
+         * @details Every fire copies the event, the last one of a batch, into a cache that holds
+         * one event of the type and is reused from then on. Updating it takes a lock of its own,
+         * not the registration lock. A handler of the type, keyed handlers included, is called
+         * once with the cached event when it is registered, before register_handler returns. A
+         * handler registered by a handler in dispatch_mode::locked receives it once the
+         * dispatch is done. A handler registered while the type is fired on another thread may
+         * receive that event twice, but does not miss it. Only events fired as EventType are
+         * cached, events of derived types are not.
+         * @tparam EventType The event type, it must be copyable.
+         */
+        template <typename EventType>
+        void make_sticky() {
+            using event_type = std::decay_t<EventType>;
+            const auto configure = [this]() {
+                auto& table = table_for(detail::type_id<event_type>());
+                if (!table.sticky.load(std::memory_order_relaxed)) {
+                    table.sticky.store(create<sticky_value<event_type>>(),
+                                       std::memory_order_release);
+                }
+            };
+            if (auto* scope = current_dispatch()) {
+                scope->mutations.emplace_back(configure);
+            } else {
+                safe_unique_registrations_access(configure);
+            }
+        }
+
+        /**
+         * @brief The cached event of a type made sticky with make_sticky().
+         * @return A copy of the most recent event, or nothing if none was fired yet or the type
+         * is not sticky.
+         */
+        template <typename EventType>
+        [[nodiscard]] std::optional<std::decay_t<EventType>> sticky_event() {
+            using event_type = std::decay_t<EventType>;
+            std::optional<event_type> result;
+            read_guarded([this, &result]() {
+                if (const auto* cache = sticky_cache_for(detail::type_id<event_type>())) {
+                    result = static_cast<const sticky_value<event_type>*>(cache)->get();
                 }
             });
+            return result;
+        }
+
+        /**
+         * @brief Forget the cached event of a sticky type, handlers registered afterwards do
+         * not receive an event until the type is fired again.
+         */
+        template <typename EventType>
+        void clear_sticky_event() {
+            read_guarded([this]() {
+                if (auto* cache =
+                        sticky_cache_for(detail::type_id<std::decay_t<EventType>>())) {
+                    cache->clear();
+                }
+            });
+        }
+
+        /**
+         * @brief Declare that events of type Derived are also delivered to the handlers of Base.
+         * @details Declarations are transitive, so declaring B as base of C and A as base of B
+         * delivers C events to the handlers of A, B and C. When a Derived event is fired the
+         * handlers run by priority. Handlers of the same priority run in the order of their event
+         * types, Derived first, followed by its bases, depth first in declaration order. Every
+         * base type is visited once, even if it is reachable along several paths.
+         *
+         * The handlers of Derived and all its bases are resolved into one flat list when a
+         * declaration or registration changes, so firing does not depend on the depth of the
+         * hierarchy. Base handlers receive batches one event at a time. Event types without
+         * declared bases are not affected.
+         * @tparam Derived The event type that is fired.
+         * @tparam Base A base class of Derived whose handlers should receive Derived events.
+         */
+        template <typename Derived, typename Base>
+        void declare_base() {
+            using derived_type = std::decay_t<Derived>;
+            using base_type = std::decay_t<Base>;
+            static_assert(std::is_base_of_v<base_type, derived_type> &&
+                              !std::is_same_v<base_type, derived_type>,
+                          "Base must be a base class of Derived.");
+            const auto declare = [this]() {
+                const auto derived = detail::type_id<derived_type>();
+                const auto base = detail::type_id<base_type>();
+                table_for(base);
+                auto& table = table_for(derived);
+                for (const auto& edge : table.bases) {
+                    if (edge.base == base) {
+                        return;
+                    }
+                }
+                table.bases.push_back({base, &upcast<derived_type, base_type>});
+                tables_[base]->derived.push_back(derived);
+                refresh_resolution(derived);
+                reclaim();
+            };
+            if (auto* scope = current_dispatch()) {
+                scope->mutations.emplace_back(declare);
+            } else {
+                safe_unique_registrations_access(declare);
+            }
         }
 
         /**
          * @brief Remove a given handler from the event bus.
+         * @details When called by a handler in dispatch_mode::locked, the handler is not called
+         * again once this returns, but it is only taken out of the bus, and handler_count()
+         * updated, when the dispatch that called the handler is done. Dispatches on other threads
+         * are not waited for in that case.
          * @param registration The registration object returned by register_handler.
          * @return true is handler removal was successful, false otherwise.
          */
         bool remove_handler(const handler_registration& registration) noexcept {
-            if (!registration.handle()) {
+            const auto& handle = registration.handle();
+            if (!handle.valid() || registration.event_bus_ != this) {
                 return false;
             }
 
+            if (auto* scope = current_dispatch()) {
+                return queue_removal(*scope, handle);
+            }
             auto result = false;
-            safe_unique_registrations_access([this, &result, &registration]() {
-                for (auto it = handler_registrations_.begin(); it != handler_registrations_.end();
-                     ++it) {
-                    if (static_cast<const void*>(&(it->second)) == registration.handle()) {
-                        handler_registrations_.erase(it);
-                        result = true;
-                        break;
-                    }
-                }
-            });
+            safe_unique_registrations_access(
+                [this, &result, &handle]() { result = remove_entry(handle, false); });
             return result;
         }
 
@@ -177,7 +541,47 @@ namespace dp {
          * @brief Remove all handlers from event bus.
          */
         void remove_handlers() noexcept {
-            safe_unique_registrations_access([this]() { handler_registrations_.clear(); });
+            const auto remove_all = [this]() {
+                const auto clear = [this](handler_table& table) {
+                    auto* handlers = table.handlers.exchange(nullptr, std::memory_order_seq_cst);
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+                    release_counters(handlers);
+#endif
+                    retire(handlers);
+                    table.removed_count = 0;
+                    table.consuming_count = 0;
+                };
+                for (auto* table : tables_) {
+                    clear(*table);
+                    for (auto* extractor : table->extractors) {
+                        clear(extractor->table);
+                    }
+                    retire(table->keys.exchange(nullptr, std::memory_order_seq_cst));
+                }
+                for (detail::type_id_t event_type = 0; event_type < tables_.size(); ++event_type) {
+                    if (!tables_[event_type]->bases.empty()) {
+                        resolve(event_type);
+                    }
+                }
+                for (std::uint32_t i = 0; i < slots_.size(); ++i) {
+                    // pending slots were reserved by handlers after this was queued, their
+                    // registrations are applied after it
+                    if (slots_[i].in_use && !slots_[i].pending) {
+                        release_slot(i);
+                    }
+                }
+                handler_count_ = 0;
+                reclaim();
+            };
+            if (auto* scope = current_dispatch()) {
+                try {
+                    scope->mutations.emplace_back(remove_all);
+                } catch (...) {
+                    // out of memory, the handlers stay registered
+                }
+            } else {
+                safe_unique_registrations_access(remove_all);
+            }
         }
 
         /**
@@ -186,21 +590,1318 @@ namespace dp {
          */
         [[nodiscard]] std::size_t handler_count() noexcept {
             std::size_t count{};
-            safe_shared_registrations_access(
-                [this, &count]() { count = handler_registrations_.size(); });
+            safe_shared_registrations_access([this, &count]() { count = handler_count_; });
             return count;
         }
 
+        /**
+         * @brief The dispatch mode this event bus was created with.
+         */
+        [[nodiscard]] dispatch_mode mode() const noexcept { return mode_; }
+
+#if EVENTBUS_HAS_COROUTINES
+        /**
+         * @brief Wait for the next event of a type in a C++20 coroutine.
+         * @details `auto evt = co_await evt_bus.next<event_type>(predicate);` suspends the
+         * coroutine until an event for which the predicate returns true is fired and resumes it
+         * with a copy of that event. The coroutine is resumed by the executor, by default directly
+         * inside fire_event. The wait registers a handler that is removed again once the event
+         * arrived or the coroutine was destroyed. Only available if EVENTBUS_HAS_COROUTINES is 1.
+         * @tparam EventType The event type, must be copy constructible.
+         * @param predicate Called with `const EventType&`, matches all events by default.
+         * @param executor Called with the std::coroutine_handle<> to resume.
+         */
+        template <typename EventType, typename Predicate = detail::any_event,
+                  typename Executor = inline_executor>
+        [[nodiscard]] next_event<event_bus, EventType, Predicate, Executor> next(
+            Predicate predicate = {}, Executor executor = {}) {
+            return {*this, std::move(predicate), std::move(executor)};
+        }
+#endif
+
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+        /**
+         * @brief Take a snapshot of the dispatch statistics.
+         * @details Only available when EVENTBUS_ENABLE_INSTRUMENTATION is 1. Counters are
+         * updated with relaxed atomics, so a snapshot taken while events are fired may be
+         * slightly inconsistent. Handlers that throw are counted and skipped instead of
+         * terminating the program.
+         */
+        [[nodiscard]] event_bus_stats stats() {
+            event_bus_stats result;
+            safe_shared_registrations_access([this, &result]() {
+                // handlers may register while the shared lock is held
+                std::lock_guard<std::mutex> lock(slots_mutex_);
+                result.shared_lock_wait = shared_lock_wait_.snapshot();
+                result.exclusive_lock_wait = exclusive_lock_wait_.snapshot();
+                for (detail::type_id_t event_type = 0; event_type < tables_.size(); ++event_type) {
+                    const auto& table = *tables_[event_type];
+                    event_type_stats type_stats;
+                    type_stats.event_type = event_type;
+                    type_stats.fires = table.counters.fires.load(std::memory_order_relaxed);
+                    type_stats.events = table.counters.events.load(std::memory_order_relaxed);
+                    type_stats.dispatch_latency = table.counters.dispatch_latency.snapshot();
+
+                    const auto add_handler_stats = [&](const handler_table& list) {
+                        const auto* handlers = list.handlers.load(std::memory_order_relaxed);
+                        const auto size = handlers ? handlers->size.load(std::memory_order_relaxed)
+                                                   : std::size_t{0};
+                        for (std::size_t i = 0; i < size; ++i) {
+                            const auto& entry = handlers->entries[i];
+                            if (!entry.active.load(std::memory_order_relaxed)) {
+                                continue;
+                            }
+                            auto& stats = type_stats.handlers.emplace_back();
+                            stats.handle = {event_type, entry.slot, slots_[entry.slot].generation};
+                            stats.calls = entry.counters->calls.load(std::memory_order_relaxed);
+                            stats.exceptions =
+                                entry.counters->exceptions.load(std::memory_order_relaxed);
+                            stats.latency = entry.counters->latency.snapshot();
+                        }
+                    };
+                    add_handler_stats(table);
+                    for (const auto* extractor : table.extractors) {
+                        add_handler_stats(extractor->table);
+                    }
+                    if (type_stats.fires != 0 || !type_stats.handlers.empty()) {
+                        result.event_types.push_back(std::move(type_stats));
+                    }
+                }
+            });
+            return result;
+        }
+#endif
+
       private:
+        // returns true if the event was consumed
+        using erased_handler = detail::inplace_handler<bool(const void*, std::size_t)>;
+
+        struct handler_entry {
+            std::uint32_t slot{0};
+            std::atomic<bool> active{false};
+            // removed by a handler, the removal is applied once its dispatch is done
+            bool removal_queued{false};
+            // called with a pointer to `count` contiguous events
+            erased_handler handler;
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+            // owned by the registration, shared by all copies of the entry
+            detail::handler_counters* counters{nullptr};
+#endif
+        };
+
+        /**
+         * Handlers of one event type. Readers only see the first `size` entries, new handlers are
+         * appended in place and published by incrementing `size`. Growing or compacting the array
+         * creates a new one that replaces this one.
+         */
+        struct handler_array {
+            handler_array(std::size_t array_capacity, std::pmr::memory_resource* resource)
+                : capacity(array_capacity), entries(array_capacity, resource) {}
+            const std::size_t capacity;
+            std::atomic<std::size_t> size{0};
+            // set once a handler that can consume events was added
+            std::atomic<bool> consuming{false};
+            // sorted by descending priority
+            std::pmr::vector<handler_entry> entries;
+        };
+
+        using upcast_function = const void* (*)(const void*) noexcept;
+
+        struct base_edge {
+            detail::type_id_t base;
+            upcast_function upcast;
+        };
+
+        struct resolved_handler {
+            const handler_entry* entry;
+            // range of upcasts to apply, in order, to get from the fired type to the handler's
+            std::uint32_t first_upcast;
+            std::uint32_t last_upcast;
+        };
+
+        /**
+         * Flattened handlers of an event type with declared bases and of all its bases. Immutable
+         * once published. It points into the handler arrays it was resolved from, so it is
+         * replaced whenever one of them is.
+         */
+        struct resolved_array {
+            explicit resolved_array(std::pmr::memory_resource* resource)
+                : handlers(resource), upcasts(resource) {}
+            bool consuming{false};
+            std::pmr::vector<resolved_handler> handlers;
+            std::pmr::vector<upcast_function> upcasts;
+        };
+
+        struct key_index;
+        struct key_extractor;
+
+        /**
+         * The most recent event of a sticky type. Fires update it under its own mutex, the
+         * registration lock is not needed, so it can be updated while handlers are dispatched.
+         */
+        struct sticky_cache {
+            sticky_cache() = default;
+            sticky_cache(const sticky_cache&) = delete;
+            sticky_cache& operator=(const sticky_cache&) = delete;
+            virtual ~sticky_cache() = default;
+            virtual void store(const void* event) noexcept = 0;
+            virtual void deliver(const handler_entry& entry) const = 0;
+            virtual void clear() noexcept = 0;
+            virtual void destroy(std::pmr::memory_resource* resource) noexcept = 0;
+
+            mutable std::mutex mutex;
+        };
+
+        template <typename EventType>
+        struct sticky_value final : sticky_cache {
+            void store(const void* event) noexcept override {
+                const auto& evt = *static_cast<const EventType*>(event);
+                std::lock_guard<std::mutex> lock(mutex);
+                try {
+                    // assigned in place, so the event keeps the storage it already allocated
+                    if (value) {
+                        *value = evt;
+                    } else {
+                        value.emplace(evt);
+                    }
+                } catch (...) {
+                    // out of memory, the previous event is dropped as well
+                    value.reset();
+                }
+            }
+
+            void deliver(const handler_entry& entry) const override {
+                // copied, the handler may fire the type and update the cache
+                if (const auto event = get()) {
+                    invoke(entry, std::addressof(*event), 1);
+                }
+            }
+
+            void clear() noexcept override {
+                std::lock_guard<std::mutex> lock(mutex);
+                value.reset();
+            }
+
+            void destroy(std::pmr::memory_resource* resource) noexcept override {
+                this->~sticky_value();
+                std::pmr::polymorphic_allocator<sticky_value>(resource).deallocate(this, 1);
+            }
+
+            std::optional<EventType> get() const {
+                std::lock_guard<std::mutex> lock(mutex);
+                return value;
+            }
+
+            std::optional<EventType> value;
+        };
+
+        struct handler_table {
+            explicit handler_table(std::pmr::memory_resource* resource)
+                : bases(resource), derived(resource), extractors(resource) {}
+            std::atomic<handler_array*> handlers{nullptr};
+            // only set for event types with declared bases
+            std::atomic<const resolved_array*> resolved{nullptr};
+            // only accessed by writers
+            std::size_t removed_count{0};
+            // priority of the last entry, handlers with a lower or equal one can be appended
+            int lowest_priority{0};
+            // number of live handlers that can consume events
+            std::size_t consuming_count{0};
+            std::pmr::vector<base_edge> bases;
+            std::pmr::vector<detail::type_id_t> derived;
+            // keyed handlers are stored in the tables of their key extractors
+            std::atomic<const key_index*> keys{nullptr};
+            std::pmr::vector<key_extractor*> extractors;
+            // pool single events are dispatched on, set by dispatch_in_parallel()
+            std::atomic<work_stealing_pool*> parallel{nullptr};
+            // most recent event, only set for types made sticky, lives as long as the bus
+            std::atomic<sticky_cache*> sticky{nullptr};
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+            mutable detail::event_type_counters counters;
+#endif
+        };
+
+        using key_hasher = detail::inplace_handler<std::size_t(const void*)>;
+
+        /**
+         * A key extractor of an event type and the handlers registered with it. Lives as long as
+         * the event bus.
+         */
+        struct key_extractor {
+            key_extractor(const void* extractor_type, const void* extractor_value,
+                          std::size_t extractor_size, key_hasher&& key_hash,
+                          std::pmr::memory_resource* resource)
+                : type(extractor_type),
+                  size(extractor_size),
+                  hasher(std::move(key_hash)),
+                  table(resource) {
+                std::memcpy(value.data(), extractor_value, size);
+            }
+            // identity of the extractor, the value is only kept for function and member pointers
+            const void* type;
+            std::size_t size;
+            std::array<unsigned char, 16> value{};
+            key_hasher hasher;
+            handler_table table;
+        };
+
+        struct key_bucket {
+            std::size_t hash{0};
+            // range of handlers with this key hash, empty for unused buckets
+            std::uint32_t first{0};
+            std::uint32_t last{0};
+        };
+
+        // open addressing hash table from key hash to handlers, immutable once published
+        struct key_lookup {
+            key_lookup(const key_hasher* key_hash, std::size_t bucket_count,
+                       std::pmr::memory_resource* resource)
+                : hasher(key_hash),
+                  mask(bucket_count - 1),
+                  buckets(bucket_count, resource),
+                  handlers(resource) {}
+            const key_hasher* hasher;
+            std::size_t mask;
+            std::pmr::vector<key_bucket> buckets;
+            // sorted by key hash, then by descending priority
+            std::pmr::vector<const handler_entry*> handlers;
+        };
+
+        struct key_index {
+            explicit key_index(std::pmr::memory_resource* resource) : lookups(resource) {}
+            std::pmr::vector<key_lookup> lookups;
+        };
+
+        // immutable once published, indexed by detail::type_id
+        struct table_directory {
+            explicit table_directory(std::pmr::memory_resource* resource) : tables(resource) {}
+            std::pmr::vector<const handler_table*> tables;
+        };
+
+        struct registration_slot {
+            detail::type_id_t event_type{0};
+            std::uint32_t generation{1};
+            std::uint32_t index{0};
+            int priority{0};
+            bool consumes{false};
+            bool in_use{false};
+            // registered by a handler, not added to a handler table yet
+            bool pending{false};
+            // removed by a handler, still in its handler table
+            bool removal_queued{false};
+            // index into the extractors of the event type for keyed handlers
+            std::uint32_t extractor{no_extractor};
+            std::size_t key_hash{0};
+        };
+
+        static constexpr std::uint32_t no_extractor = ~std::uint32_t{0};
+
+        template <typename T>
+        struct type_tag {
+            static constexpr char id{0};
+        };
+
+        using mutation = detail::inplace_handler<void()>;
+
+        /**
+         * Marks the outermost dispatch of a bus in dispatch_mode::locked on the current thread.
+         * Handlers that register or remove handlers of that bus queue the change here, since the
+         * thread already holds the shared lock. The changes are applied once the lock is released.
+         */
+        struct dispatch_scope {
+            dispatch_scope(const event_bus* owner, std::vector<mutation>& queued) noexcept
+                : bus(owner), outer(std::exchange(innermost(), this)), mutations(queued) {}
+            dispatch_scope(const dispatch_scope&) = delete;
+            dispatch_scope& operator=(const dispatch_scope&) = delete;
+            ~dispatch_scope() { innermost() = outer; }
+
+            static dispatch_scope*& innermost() noexcept {
+                thread_local dispatch_scope* scope{nullptr};
+                return scope;
+            }
+
+            const event_bus* bus;
+            dispatch_scope* outer;
+            std::vector<mutation>& mutations;
+        };
+
+        template <typename EventType>
+        struct async_fire : detail::completion_state {
+            template <typename Event>
+            explicit async_fire(Event&& evt) : event(std::forward<Event>(evt)) {}
+            EventType event;
+        };
+
+        /**
+         * One event dispatched to the handlers of an array in parallel. The handlers are split
+         * into chunks of consecutive entries, threads claim chunks until none are left.
+         */
+        struct parallel_fan_out {
+            parallel_fan_out(const event_bus* owner, const handler_array& array,
+                             std::size_t handler_count, const void* evt, std::size_t chunks)
+                : bus(owner),
+                  handlers(array),
+                  size(handler_count),
+                  event(evt),
+                  chunk_size((handler_count + chunks - 1) / chunks),
+                  chunk_count((handler_count + chunk_size - 1) / chunk_size) {
+                if (bus->mode_ == dispatch_mode::locked) {
+                    mutations.resize(chunk_count);
+                }
+            }
+
+            void run_chunks() {
+                for (auto chunk = next.fetch_add(1, std::memory_order_relaxed);
+                     chunk < chunk_count; chunk = next.fetch_add(1, std::memory_order_relaxed)) {
+                    const auto first = chunk * chunk_size;
+                    const auto last = std::min(size, first + chunk_size);
+                    if (mutations.empty()) {
+                        run(first, last);
+                    } else {
+                        // the shared lock is held by the thread waiting for this fan out
+                        const dispatch_scope scope(bus, mutations[chunk]);
+                        run(first, last);
+                    }
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (++finished == chunk_count) {
+                        done.notify_all();
+                    }
+                }
+            }
+
+            void run(std::size_t first, std::size_t last) const {
+                for (auto i = first; i < last; ++i) {
+                    const auto& entry = handlers.entries[i];
+                    if (entry.active.load(std::memory_order_acquire)) {
+                        invoke(entry, event, 1);
+                    }
+                }
+            }
+
+            void wait() {
+                std::unique_lock<std::mutex> lock(mutex);
+                done.wait(lock, [this]() { return finished == chunk_count; });
+            }
+
+            const event_bus* bus;
+            const handler_array& handlers;
+            const std::size_t size;
+            const void* event;
+            const std::size_t chunk_size;
+            const std::size_t chunk_count;
+            std::atomic<std::size_t> next{0};
+            // changes queued by handlers of each chunk, only used in dispatch_mode::locked
+            std::vector<std::vector<mutation>> mutations;
+
+            std::mutex mutex;
+            std::condition_variable done;
+            std::size_t finished{0};
+        };
+
         using mutex_type = std::shared_mutex;
+        const dispatch_mode mode_;
+        std::pmr::memory_resource* resource_;
         mutable mutex_type registration_mutex_;
-        std::unordered_multimap<std::type_index, std::function<void(std::any)>>
-            handler_registrations_;
+        detail::epoch_reclaimer reclaimer_;
+        std::atomic<const table_directory*> directory_{nullptr};
+
+        // writer side state, guarded by registration_mutex_
+        std::pmr::vector<handler_table*> tables_;
+        // maps registration handles to their entry in the handler tables
+        std::pmr::vector<registration_slot> slots_;
+        std::pmr::vector<std::uint32_t> free_slots_;
+        // guards slots_ and free_slots_ for handlers that hold the shared lock, see dispatch_scope
+        std::mutex slots_mutex_;
+        std::size_t handler_count_{0};
+        // handlers of sticky types registered by handlers, see apply_mutations()
+        std::vector<registration_handle> sticky_deliveries_;
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+        detail::atomic_histogram shared_lock_wait_;
+        detail::atomic_histogram exclusive_lock_wait_;
+#endif
+
+        void dispatch_guarded(detail::type_id_t event_type, const void* events, std::size_t count,
+                              std::size_t event_size,
+                              work_stealing_pool* pool = nullptr) noexcept {
+            read_guarded([this, event_type, events, count, event_size, pool]() {
+                dispatch(event_type, events, count, event_size, pool);
+            });
+        }
+
+        // call a function that reads the handler tables and may call handlers
+        template <typename Function>
+        void read_guarded(Function&& function) noexcept {
+            if (mode_ == dispatch_mode::lock_free) {
+                const auto guard = reclaimer_.enter();
+                function();
+            } else if (current_dispatch()) {
+                // called by a handler of this bus, the shared lock is already held
+                function();
+            } else {
+                std::vector<mutation> mutations;
+                safe_shared_registrations_access([this, &mutations, &function]() {
+                    const dispatch_scope scope(this, mutations);
+                    function();
+                });
+                if (!mutations.empty()) {
+                    apply_mutations(mutations);
+                }
+            }
+        }
+
+        // the dispatch of this bus the calling thread is in, only tracked in dispatch_mode::locked
+        [[nodiscard]] dispatch_scope* current_dispatch() const noexcept {
+            if (mode_ != dispatch_mode::locked) {
+                return nullptr;
+            }
+            for (auto* scope = dispatch_scope::innermost(); scope; scope = scope->outer) {
+                if (scope->bus == this) {
+                    return scope;
+                }
+            }
+            return nullptr;
+        }
+
+        void apply_mutations(std::vector<mutation>& mutations) noexcept {
+            std::vector<registration_handle> deliveries;
+            safe_unique_registrations_access([this, &mutations, &deliveries]() {
+                for (auto& apply : mutations) {
+                    try {
+                        apply();
+                    } catch (...) {
+                        // out of memory, the change is dropped
+                    }
+                }
+                deliveries.swap(sticky_deliveries_);
+            });
+            for (const auto& handle : deliveries) {
+                deliver_sticky(handle);
+            }
+        }
+
+        // deliver the cached event of a sticky type to a handler that was just registered
+        void deliver_sticky(const registration_handle& handle) noexcept {
+            read_guarded([this, &handle]() {
+                const auto* cache = sticky_cache_for(handle.event_type);
+                if (!cache) {
+                    return;
+                }
+                const auto* directory = directory_.load(std::memory_order_seq_cst);
+                if (const auto* entry =
+                        find_active_entry(*directory->tables[handle.event_type], handle.slot)) {
+                    cache->deliver(*entry);
+                }
+            });
+        }
+
+        sticky_cache* sticky_cache_for(detail::type_id_t event_type) const noexcept {
+            const auto* directory = directory_.load(std::memory_order_seq_cst);
+            if (!directory || event_type >= directory->tables.size()) {
+                return nullptr;
+            }
+            return directory->tables[event_type]->sticky.load(std::memory_order_acquire);
+        }
+
+        // a slot is only reused once its handler was removed, so at most one active entry has it
+        static const handler_entry* find_active_entry(const handler_table& table,
+                                                      std::uint32_t slot) noexcept {
+            const auto matches = [slot](const handler_entry& entry) {
+                // entries that are not active yet may still be written
+                return entry.active.load(std::memory_order_acquire) && entry.slot == slot;
+            };
+            if (const auto* handlers = table.handlers.load(std::memory_order_seq_cst)) {
+                const auto size = handlers->size.load(std::memory_order_acquire);
+                for (std::size_t i = 0; i < size; ++i) {
+                    if (matches(handlers->entries[i])) {
+                        return &handlers->entries[i];
+                    }
+                }
+            }
+            if (const auto* keys = table.keys.load(std::memory_order_seq_cst)) {
+                for (const auto& lookup : keys->lookups) {
+                    for (const auto* entry : lookup.handlers) {
+                        if (matches(*entry)) {
+                            return entry;
+                        }
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        void dispatch(detail::type_id_t event_type, const void* events, std::size_t count,
+                      std::size_t event_size, work_stealing_pool* pool) const {
+            const auto* directory = directory_.load(std::memory_order_seq_cst);
+            // only call the functions we need to
+            if (!directory || event_type >= directory->tables.size()) {
+                return;
+            }
+            const auto& table = *directory->tables[event_type];
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+            const auto start = std::chrono::steady_clock::now();
+#endif
+            if (auto* sticky = table.sticky.load(std::memory_order_acquire)) {
+                // before the handlers are looked up, so handlers registered meanwhile get it
+                sticky->store(static_cast<const unsigned char*>(events) + (count - 1) * event_size);
+            }
+            const auto* keys = table.keys.load(std::memory_order_seq_cst);
+            if (!pool && count == 1) {
+                pool = table.parallel.load(std::memory_order_relaxed);
+            }
+            if (pool && count == 1 && dispatch_parallel(table, *pool, events)) {
+                if (keys) {
+                    dispatch_keyed(*keys, events);
+                }
+            } else if (keys && count > 1) {
+                // keys are matched one event at a time
+                const auto* event = static_cast<const unsigned char*>(events);
+                for (std::size_t i = 0; i < count; ++i, event += event_size) {
+                    if (!dispatch_table(table, event, 1, event_size)) {
+                        dispatch_keyed(*keys, event);
+                    }
+                }
+            } else if (!dispatch_table(table, events, count, event_size) && keys) {
+                dispatch_keyed(*keys, events);
+            }
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+            table.counters.fires.fetch_add(1, std::memory_order_relaxed);
+            table.counters.events.fetch_add(count, std::memory_order_relaxed);
+            table.counters.dispatch_latency.record(std::chrono::steady_clock::now() - start);
+#endif
+        }
+
+        // dispatch to the handlers without a key, returns true if a single event was consumed
+        static bool dispatch_table(const handler_table& table, const void* events,
+                                   std::size_t count, std::size_t event_size) {
+            if (const auto* resolved = table.resolved.load(std::memory_order_seq_cst)) {
+                return dispatch_resolved(*resolved, events, count, event_size);
+            }
+            const auto* handlers = table.handlers.load(std::memory_order_seq_cst);
+            if (!handlers) {
+                return false;
+            }
+            const auto size = handlers->size.load(std::memory_order_acquire);
+            if (count > 1 && handlers->consuming.load(std::memory_order_relaxed)) {
+                // handlers that consume events need to see them one at a time
+                const auto* event = static_cast<const unsigned char*>(events);
+                for (std::size_t i = 0; i < count; ++i, event += event_size) {
+                    dispatch_array(*handlers, size, event, 1);
+                }
+                return false;
+            }
+            return dispatch_array(*handlers, size, events, count);
+        }
+
+        /**
+         * Call the handlers of a table without a key in parallel. Returns false, without calling
+         * any handler, if they have to be dispatched on the calling thread: handlers that can
+         * consume events need to run in order and too few handlers are not worth the hand off.
+         */
+        bool dispatch_parallel(const handler_table& table, work_stealing_pool& pool,
+                               const void* event) const {
+            if (table.resolved.load(std::memory_order_seq_cst)) {
+                return false;
+            }
+            const auto* handlers = table.handlers.load(std::memory_order_seq_cst);
+            if (!handlers) {
+                return false;
+            }
+            const auto size = handlers->size.load(std::memory_order_acquire);
+            if (size < 2 || handlers->consuming.load(std::memory_order_relaxed)) {
+                return false;
+            }
+
+            std::shared_ptr<parallel_fan_out> fan_out;
+            try {
+                fan_out = std::make_shared<parallel_fan_out>(
+                    this, *handlers, size, event, std::min(size, pool.thread_count() + 1));
+            } catch (...) {
+                return false;
+            }
+            try {
+                for (std::size_t i = 1; i < fan_out->chunk_count; ++i) {
+                    pool.submit([fan_out]() { fan_out->run_chunks(); });
+                }
+            } catch (...) {
+                // out of memory, the calling thread runs the chunks no worker claims
+            }
+            fan_out->run_chunks();
+            fan_out->wait();
+
+            if (auto* scope = current_dispatch()) {
+                for (auto& chunk_mutations : fan_out->mutations) {
+                    for (auto& queued : chunk_mutations) {
+                        try {
+                            scope->mutations.push_back(std::move(queued));
+                        } catch (...) {
+                            // out of memory, the change is dropped
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+        static bool dispatch_keyed(const key_index& keys, const void* event) {
+            for (const auto& lookup : keys.lookups) {
+                const auto hash = (*lookup.hasher)(event);
+                for (auto i = hash & lookup.mask;; i = (i + 1) & lookup.mask) {
+                    const auto& bucket = lookup.buckets[i];
+                    if (bucket.first == bucket.last) {
+                        break;
+                    }
+                    if (bucket.hash != hash) {
+                        continue;
+                    }
+                    for (auto j = bucket.first; j != bucket.last; ++j) {
+                        const auto& entry = *lookup.handlers[j];
+                        if (entry.active.load(std::memory_order_acquire) &&
+                            invoke(entry, event, 1)) {
+                            return true;
+                        }
+                    }
+                    break;
+                }
+            }
+            return false;
+        }
+
+        static bool dispatch_array(const handler_array& handlers, std::size_t size,
+                                   const void* events, std::size_t count) {
+            for (std::size_t i = 0; i < size; ++i) {
+                const auto& entry = handlers.entries[i];
+                // removed handlers stay in place until the table is compacted
+                if (entry.active.load(std::memory_order_acquire) && invoke(entry, events, count)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static bool dispatch_resolved(const resolved_array& resolved, const void* events,
+                                      std::size_t count, std::size_t event_size) {
+            if (count > 1 && resolved.consuming) {
+                const auto* event = static_cast<const unsigned char*>(events);
+                for (std::size_t i = 0; i < count; ++i, event += event_size) {
+                    dispatch_resolved(resolved, event, 1, event_size);
+                }
+                return false;
+            }
+            for (const auto& item : resolved.handlers) {
+                if (!item.entry->active.load(std::memory_order_acquire)) {
+                    continue;
+                }
+                if (item.first_upcast == item.last_upcast) {
+                    if (invoke(*item.entry, events, count)) {
+                        return true;
+                    }
+                    continue;
+                }
+                // a batch of derived events is not an array of base objects, upcast one by one
+                const auto* event = static_cast<const unsigned char*>(events);
+                for (std::size_t i = 0; i < count; ++i, event += event_size) {
+                    const void* base_event = event;
+                    for (auto u = item.first_upcast; u != item.last_upcast; ++u) {
+                        base_event = resolved.upcasts[u](base_event);
+                    }
+                    if (invoke(*item.entry, base_event, 1)) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        static bool invoke(const handler_entry& entry, const void* events, std::size_t count) {
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+            const auto start = std::chrono::steady_clock::now();
+            auto consumed = false;
+            try {
+                consumed = entry.handler(events, count);
+            } catch (...) {
+                entry.counters->exceptions.fetch_add(1, std::memory_order_relaxed);
+            }
+            entry.counters->latency.record(std::chrono::steady_clock::now() - start);
+            entry.counters->calls.fetch_add(1, std::memory_order_relaxed);
+            return consumed;
+#else
+            return entry.handler(events, count);
+#endif
+        }
+
+        // calls function(i) for every event index, returns whether the last event was consumed
+        template <typename Function>
+        static bool call_for_each(std::size_t count, Function&& function) {
+            auto consumed = false;
+            for (std::size_t i = 0; i < count; ++i) {
+                if constexpr (std::is_same_v<decltype(function(i)), bool>) {
+                    consumed = function(i);
+                } else {
+                    function(i);
+                }
+            }
+            return consumed;
+        }
+
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+
+        // retire the counters of all handlers of an array that is about to be retired
+        void release_counters(const handler_array* handlers) {
+            const auto size = handlers ? handlers->size.load(std::memory_order_relaxed)
+                                       : std::size_t{0};
+            for (std::size_t i = 0; i < size; ++i) {
+                const auto& entry = handlers->entries[i];
+                if (entry.active.load(std::memory_order_relaxed) || entry.removal_queued) {
+                    retire(entry.counters);
+                }
+            }
+        }
+#endif
+
+        template <typename EventType, typename Handler, typename KeyExtractor = std::nullptr_t>
+        handler_registration add_handler(Handler&& handler_function, int priority, bool consumes,
+                                         KeyExtractor extract_key = nullptr,
+                                         std::size_t key_hash = 0) {
+            registration_handle handle{detail::type_id<EventType>(), 0, 0};
+            if (auto* scope = current_dispatch()) {
+                // called by a handler while the shared lock is held. The handle is reserved now,
+                // the handler is added once the dispatch is done.
+                reserve_slot(handle, true);
+                try {
+                    scope->mutations.emplace_back(
+                        [this, handle, handler = std::forward<Handler>(handler_function), priority,
+                         consumes, extract_key = std::move(extract_key), key_hash]() mutable {
+                            insert_handler<EventType>(handle, std::move(handler), priority,
+                                                      consumes, extract_key, key_hash);
+                            if (is_sticky_handler(handle)) {
+                                sticky_deliveries_.push_back(handle);
+                            }
+                        });
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(slots_mutex_);
+                    release_slot(handle.slot);
+                    throw;
+                }
+            } else {
+                auto sticky = false;
+                safe_unique_registrations_access([&]() {
+                    reserve_slot(handle, false);
+                    insert_handler<EventType>(handle, std::forward<Handler>(handler_function),
+                                              priority, consumes, extract_key, key_hash);
+                    sticky = is_sticky_handler(handle);
+                });
+                if (sticky) {
+                    deliver_sticky(handle);
+                }
+            }
+            return {handle, this, [](void* bus, const handler_registration& registration) {
+                        return static_cast<event_bus*>(bus)->remove_handler(registration);
+                    }};
+        }
+
+        // whether a handler was added to a sticky type, called with the unique lock held
+        bool is_sticky_handler(const registration_handle& handle) const noexcept {
+            return handle.event_type < tables_.size() &&
+                   tables_[handle.event_type]->sticky.load(std::memory_order_relaxed) &&
+                   slots_[handle.slot].generation == handle.generation;
+        }
+
+        /**
+         * Remove a handler while holding the registration lock exclusively.
+         * @param queued Whether this applies a removal queued by queue_removal().
+         */
+        bool remove_entry(const registration_handle& handle, bool queued) {
+            if (handle.slot >= slots_.size()) {
+                return false;
+            }
+            auto& slot = slots_[handle.slot];
+            if (slot.generation != handle.generation || slot.event_type != handle.event_type) {
+                // stale handle, the handler was already removed
+                return false;
+            }
+            if (slot.removal_queued && !queued) {
+                // already removed by a handler, the removal is applied after its dispatch
+                return false;
+            }
+            if (slot.pending) {
+                // registered by a handler and not added yet
+                release_slot(handle.slot);
+                return true;
+            }
+
+            const auto keyed = slot.extractor != no_extractor;
+            auto& table = keyed ? tables_[handle.event_type]->extractors[slot.extractor]->table
+                                : *tables_[handle.event_type];
+            auto* handlers = table.handlers.load(std::memory_order_relaxed);
+            auto& entry = handlers->entries[slot.index];
+            entry.active.store(false, std::memory_order_release);
+            entry.removal_queued = false;
+            if (slot.consumes && --table.consuming_count == 0) {
+                handlers->consuming.store(false, std::memory_order_relaxed);
+            }
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+            retire(entry.counters);
+#endif
+            ++table.removed_count;
+            release_slot(handle.slot);
+            --handler_count_;
+
+            // compact once at least half of the table is removed, amortized O(1) per removal
+            if (table.removed_count * 2 >= handlers->size.load(std::memory_order_relaxed)) {
+                rebuild(table, 0);
+                if (keyed) {
+                    refresh_keys(*tables_[handle.event_type]);
+                } else {
+                    refresh_resolution(handle.event_type);
+                }
+            }
+            reclaim();
+            return true;
+        }
+
+        /**
+         * Remove a handler from within a dispatch that holds the shared lock. The handler is not
+         * called anymore once this returns, it is taken out of its table after the dispatch.
+         */
+        bool queue_removal(dispatch_scope& scope, const registration_handle& handle) {
+            std::lock_guard<std::mutex> lock(slots_mutex_);
+            if (handle.slot >= slots_.size()) {
+                return false;
+            }
+            auto& slot = slots_[handle.slot];
+            if (slot.generation != handle.generation || slot.event_type != handle.event_type ||
+                slot.removal_queued) {
+                return false;
+            }
+            if (slot.pending) {
+                // the queued registration sees the new generation and is dropped
+                release_slot(handle.slot);
+                return true;
+            }
+            try {
+                scope.mutations.emplace_back([this, handle]() { remove_entry(handle, true); });
+            } catch (...) {
+                return false;
+            }
+            const auto& table =
+                slot.extractor != no_extractor
+                    ? tables_[handle.event_type]->extractors[slot.extractor]->table
+                    : *tables_[handle.event_type];
+            auto& entry = table.handlers.load(std::memory_order_relaxed)->entries[slot.index];
+            entry.removal_queued = true;
+            entry.active.store(false, std::memory_order_release);
+            slot.removal_queued = true;
+            return true;
+        }
+
+        void reserve_slot(registration_handle& handle, bool pending) {
+            std::lock_guard<std::mutex> lock(slots_mutex_);
+            handle.slot = acquire_slot();
+            auto& slot = slots_[handle.slot];
+            slot.event_type = handle.event_type;
+            slot.pending = pending;
+            handle.generation = slot.generation;
+        }
+
+        /**
+         * Add a handler to the handler table of its type, the slot of the handle is already
+         * reserved. Releases the slot if the handler cannot be added.
+         */
+        template <typename EventType, typename Handler, typename KeyExtractor>
+        void insert_handler(const registration_handle& handle, Handler&& handler_function,
+                            int priority, bool consumes, const KeyExtractor& extract_key,
+                            std::size_t key_hash) {
+            if (slots_[handle.slot].generation != handle.generation) {
+                // removed before the dispatch that registered it was done
+                return;
+            }
+            erased_handler handler;
+            handler_table* event_table{nullptr};
+            auto extractor = no_extractor;
+            handler_table* table{nullptr};
+            handler_array* handlers{nullptr};
+            std::size_t index{0};
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+            detail::handler_counters* counters{nullptr};
+#endif
+            try {
+                handler = erased_handler(std::allocator_arg, resource_,
+                                         std::forward<Handler>(handler_function));
+                event_table = &table_for(handle.event_type);
+                if constexpr (!std::is_null_pointer_v<KeyExtractor>) {
+                    extractor = extractor_for<EventType>(*event_table, extract_key);
+                }
+                table = extractor == no_extractor ? event_table
+                                                  : &event_table->extractors[extractor]->table;
+                handlers = table->handlers.load(std::memory_order_relaxed);
+                const auto size =
+                    handlers ? handlers->size.load(std::memory_order_relaxed) : std::size_t{0};
+                if (handlers && size < handlers->capacity &&
+                    (size == 0 || priority <= table->lowest_priority)) {
+                    // no handler has a lower priority, append in place
+                    index = size;
+                    table->lowest_priority = priority;
+                } else {
+                    std::tie(handlers, index) = rebuild(*table, 1, priority);
+                }
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+                counters = create<detail::handler_counters>();
+#endif
+            } catch (...) {
+                release_slot(handle.slot);
+                throw;
+            }
+
+            auto& slot = slots_[handle.slot];
+            slot.index = static_cast<std::uint32_t>(index);
+            slot.priority = priority;
+            slot.consumes = consumes;
+            slot.extractor = extractor;
+            slot.key_hash = key_hash;
+            slot.pending = false;
+
+            auto& entry = handlers->entries[index];
+            entry.slot = handle.slot;
+            entry.handler = std::move(handler);
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+            entry.counters = counters;
+#endif
+            if (consumes) {
+                ++table->consuming_count;
+                handlers->consuming.store(true, std::memory_order_relaxed);
+            }
+            entry.active.store(true, std::memory_order_release);
+            if (index == handlers->size.load(std::memory_order_relaxed)) {
+                // appended, otherwise the entry fills a gap left by rebuild()
+                handlers->size.store(index + 1, std::memory_order_release);
+            }
+            ++handler_count_;
+            if (extractor == no_extractor) {
+                refresh_resolution(handle.event_type);
+            } else {
+                refresh_keys(*event_table);
+            }
+            reclaim();
+        }
+
+        handler_table& table_for(detail::type_id_t event_type) {
+            if (event_type >= tables_.size()) {
+                while (tables_.size() <= event_type) {
+                    tables_.push_back(create<handler_table>(resource_));
+                }
+                auto* directory = create<table_directory>(resource_);
+                directory->tables.assign(tables_.begin(), tables_.end());
+                retire(directory_.exchange(directory, std::memory_order_seq_cst));
+            }
+            return *tables_[event_type];
+        }
+
+        /**
+         * Replace the handler array of a table with a compacted copy that has room for at least
+         * `extra_capacity` more handlers. If `gap_priority` is set, an inactive entry is left
+         * where a handler with that priority belongs, after all handlers with the same or a
+         * higher priority.
+         * @return The new array and the index of the gap, or its size if there is no gap.
+         */
+        std::pair<handler_array*, std::size_t> rebuild(handler_table& table,
+                                                       std::size_t extra_capacity,
+                                                       std::optional<int> gap_priority = {}) {
+            auto* old_handlers = table.handlers.load(std::memory_order_relaxed);
+            const auto old_size = old_handlers ? old_handlers->size.load(std::memory_order_relaxed)
+                                               : std::size_t{0};
+            const auto live_count = old_size - table.removed_count;
+            const auto capacity = std::max<std::size_t>(4, (live_count + extra_capacity) * 2);
+
+            auto* handlers = create<handler_array>(capacity, resource_);
+            std::size_t size{0};
+            std::optional<std::size_t> gap;
+            auto consuming = false;
+            for (std::size_t i = 0; i < old_size; ++i) {
+                const auto& old_entry = old_handlers->entries[i];
+                // entries with a queued removal keep their place until the removal is applied
+                const auto active = old_entry.active.load(std::memory_order_relaxed);
+                if (!active && !old_entry.removal_queued) {
+                    continue;
+                }
+                const auto& slot = slots_[old_entry.slot];
+                if (gap_priority && !gap && slot.priority < *gap_priority) {
+                    gap = size++;
+                }
+                auto& entry = handlers->entries[size];
+                entry.slot = old_entry.slot;
+                entry.handler = old_entry.handler;
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+                entry.counters = old_entry.counters;
+#endif
+                entry.removal_queued = old_entry.removal_queued;
+                entry.active.store(active, std::memory_order_relaxed);
+                slots_[entry.slot].index = static_cast<std::uint32_t>(size);
+                consuming = consuming || (active && slot.consumes);
+                table.lowest_priority = slot.priority;
+                ++size;
+            }
+            if (gap_priority && !gap) {
+                gap = size++;
+                table.lowest_priority = *gap_priority;
+            }
+            handlers->size.store(size, std::memory_order_relaxed);
+            handlers->consuming.store(consuming, std::memory_order_relaxed);
+            table.removed_count = 0;
+
+            table.handlers.store(handlers, std::memory_order_seq_cst);
+            retire(old_handlers);
+            return {handlers, gap.value_or(size)};
+        }
+
+        /**
+         * Find the extractor of an event type that is the same as the given one or add it.
+         * @return The index of the extractor in the extractors of the table.
+         */
+        template <typename EventType, typename KeyExtractor>
+        std::uint32_t extractor_for(handler_table& table, const KeyExtractor& extractor) {
+            const void* type = &type_tag<KeyExtractor>::id;
+            // function and member pointers of the same type can still extract different keys
+            constexpr auto by_value =
+                (std::is_pointer_v<KeyExtractor> || std::is_member_pointer_v<KeyExtractor>) &&
+                sizeof(KeyExtractor) <= sizeof(key_extractor::value);
+            const auto size = by_value ? sizeof(KeyExtractor) : std::size_t{0};
+            for (std::uint32_t i = 0; i < table.extractors.size(); ++i) {
+                const auto& existing = *table.extractors[i];
+                if (existing.type == type &&
+                    std::memcmp(existing.value.data(), &extractor, size) == 0) {
+                    return i;
+                }
+            }
+
+            using key_type =
+                std::decay_t<std::invoke_result_t<const KeyExtractor&, const EventType&>>;
+            key_hasher hasher(std::allocator_arg, resource_, [extractor](const void* event) {
+                return std::hash<key_type>{}(
+                    std::invoke(extractor, *static_cast<const EventType*>(event)));
+            });
+            table.extractors.reserve(table.extractors.size() + 1);
+            table.extractors.push_back(
+                create<key_extractor>(type, &extractor, size, std::move(hasher), resource_));
+            return static_cast<std::uint32_t>(table.extractors.size() - 1);
+        }
+
+        /**
+         * Rebuild and publish the key index of an event type from the handlers of its key
+         * extractors.
+         */
+        void refresh_keys(handler_table& table) {
+            auto* keys = create<key_index>(resource_);
+            try {
+                keys->lookups.reserve(table.extractors.size());
+                std::pmr::vector<std::pair<std::size_t, const handler_entry*>> keyed(resource_);
+                for (const auto* extractor : table.extractors) {
+                    keyed.clear();
+                    const auto* handlers =
+                        extractor->table.handlers.load(std::memory_order_relaxed);
+                    const auto size =
+                        handlers ? handlers->size.load(std::memory_order_relaxed) : std::size_t{0};
+                    for (std::size_t i = 0; i < size; ++i) {
+                        const auto& entry = handlers->entries[i];
+                        if (entry.active.load(std::memory_order_relaxed)) {
+                            keyed.emplace_back(slots_[entry.slot].key_hash, &entry);
+                        }
+                    }
+                    if (keyed.empty()) {
+                        continue;
+                    }
+                    // stable, so handlers with the same key stay in priority order
+                    std::stable_sort(keyed.begin(), keyed.end(),
+                                     [](const auto& lhs, const auto& rhs) {
+                                         return lhs.first < rhs.first;
+                                     });
+
+                    // at most half of the buckets are used
+                    std::size_t bucket_count{4};
+                    while (bucket_count < keyed.size() * 2) {
+                        bucket_count *= 2;
+                    }
+                    auto& lookup = keys->lookups.emplace_back(&extractor->hasher, bucket_count,
+                                                              resource_);
+                    for (std::size_t first = 0; first < keyed.size();) {
+                        const auto hash = keyed[first].first;
+                        auto last = first;
+                        for (; last < keyed.size() && keyed[last].first == hash; ++last) {
+                            lookup.handlers.push_back(keyed[last].second);
+                        }
+                        auto bucket = hash & lookup.mask;
+                        while (lookup.buckets[bucket].first != lookup.buckets[bucket].last) {
+                            bucket = (bucket + 1) & lookup.mask;
+                        }
+                        lookup.buckets[bucket] = {hash, static_cast<std::uint32_t>(first),
+                                                  static_cast<std::uint32_t>(last)};
+                        first = last;
+                    }
+                }
+            } catch (...) {
+                destroy(keys);
+                throw;
+            }
+            if (keys->lookups.empty()) {
+                destroy(keys);
+                keys = nullptr;
+            }
+            retire(table.keys.exchange(keys, std::memory_order_seq_cst));
+        }
+
+        template <typename Derived, typename Base>
+        static const void* upcast(const void* event) noexcept {
+            return static_cast<const Base*>(static_cast<const Derived*>(event));
+        }
+
+        /**
+         * Re-resolve every event type whose resolved handlers include the handlers of the given
+         * event type.
+         */
+        void refresh_resolution(detail::type_id_t event_type) {
+            const auto& table = *tables_[event_type];
+            if (!table.bases.empty()) {
+                resolve(event_type);
+            }
+            for (const auto derived : table.derived) {
+                refresh_resolution(derived);
+            }
+        }
+
+        void resolve(detail::type_id_t event_type) {
+            auto* resolved = create<resolved_array>(resource_);
+            std::pmr::vector<upcast_function> path(resource_);
+            std::pmr::vector<bool> visited(tables_.size(), false, resource_);
+            try {
+                resolve_into(*resolved, event_type, path, visited);
+                std::stable_sort(resolved->handlers.begin(), resolved->handlers.end(),
+                                 [this](const resolved_handler& lhs, const resolved_handler& rhs) {
+                                     return slots_[lhs.entry->slot].priority >
+                                            slots_[rhs.entry->slot].priority;
+                                 });
+            } catch (...) {
+                destroy(resolved);
+                throw;
+            }
+            retire(tables_[event_type]->resolved.exchange(resolved, std::memory_order_seq_cst));
+        }
+
+        void resolve_into(resolved_array& resolved, detail::type_id_t event_type,
+                          std::pmr::vector<upcast_function>& path,
+                          std::pmr::vector<bool>& visited) const {
+            if (visited[event_type]) {
+                return;
+            }
+            visited[event_type] = true;
+            const auto& table = *tables_[event_type];
+            if (const auto* handlers = table.handlers.load(std::memory_order_relaxed)) {
+                const auto first_upcast = static_cast<std::uint32_t>(resolved.upcasts.size());
+                resolved.upcasts.insert(resolved.upcasts.end(), path.begin(), path.end());
+                const auto last_upcast = static_cast<std::uint32_t>(resolved.upcasts.size());
+                const auto size = handlers->size.load(std::memory_order_relaxed);
+                for (std::size_t i = 0; i < size; ++i) {
+                    const auto& entry = handlers->entries[i];
+                    if (entry.active.load(std::memory_order_relaxed)) {
+                        resolved.handlers.push_back({&entry, first_upcast, last_upcast});
+                        resolved.consuming = resolved.consuming || slots_[entry.slot].consumes;
+                    }
+                }
+            }
+            for (const auto& edge : table.bases) {
+                path.push_back(edge.upcast);
+                resolve_into(resolved, edge.base, path, visited);
+                path.pop_back();
+            }
+        }
+
+        template <typename T>
+        void retire(T* object) {
+            if (mode_ == dispatch_mode::lock_free) {
+                // readers may still hold the old object
+                reclaimer_.retire(object);
+            } else {
+                // the unique lock is held, so no reader can see the object anymore
+                destroy(object);
+            }
+        }
+
+        template <typename T, typename... Args>
+        T* create(Args&&... args) {
+            std::pmr::polymorphic_allocator<T> allocator(resource_);
+            auto* object = allocator.allocate(1);
+            try {
+                ::new (static_cast<void*>(object)) T(std::forward<Args>(args)...);
+            } catch (...) {
+                allocator.deallocate(object, 1);
+                throw;
+            }
+            return object;
+        }
+
+        template <typename T>
+        void destroy(T* object) noexcept {
+            if (object) {
+                auto* mutable_object = const_cast<std::remove_const_t<T>*>(object);
+                mutable_object->~T();
+                std::pmr::polymorphic_allocator<std::remove_const_t<T>>(resource_).deallocate(
+                    mutable_object, 1);
+            }
+        }
+
+        void reclaim() noexcept {
+            if (mode_ == dispatch_mode::lock_free) {
+                reclaimer_.reclaim();
+            }
+        }
+
+        std::uint32_t acquire_slot() {
+            std::uint32_t index;
+            if (free_slots_.empty()) {
+                index = static_cast<std::uint32_t>(slots_.size());
+                slots_.emplace_back();
+            } else {
+                index = free_slots_.back();
+                free_slots_.pop_back();
+            }
+            auto& slot = slots_[index];
+            slot.in_use = true;
+            slot.pending = false;
+            slot.removal_queued = false;
+            return index;
+        }
+
+        void release_slot(std::uint32_t index) {
+            auto& slot = slots_[index];
+            slot.in_use = false;
+            // generation 0 is reserved for invalid handles
+            if (++slot.generation == 0) {
+                slot.generation = 1;
+            }
+            free_slots_.push_back(index);
+        }
+
+        template <typename Lock>
+        void lock_registrations(Lock& lock) {
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+            const auto start = std::chrono::steady_clock::now();
+            lock.lock();
+            auto& wait = std::is_same_v<Lock, std::shared_lock<mutex_type>> ? shared_lock_wait_
+                                                                            : exclusive_lock_wait_;
+            wait.record(std::chrono::steady_clock::now() - start);
+#else
+            lock.lock();
+#endif
+        }
 
         template <typename Callable>
         void safe_shared_registrations_access(Callable&& callable) {
+            if (current_dispatch()) {
+                // called by a handler, this thread already holds the shared lock
+                callable();
+                return;
+            }
             try {
-                std::shared_lock<mutex_type> lock(registration_mutex_);
+                std::shared_lock<mutex_type> lock(registration_mutex_, std::defer_lock);
+                lock_registrations(lock);
                 callable();
             } catch (std::system_error&) {
             }
@@ -209,36 +1910,12 @@ namespace dp {
         void safe_unique_registrations_access(Callable&& callable) {
             try {
                 // if this fails, an exception may be thrown.
-                std::unique_lock<mutex_type> lock(registration_mutex_);
+                std::unique_lock<mutex_type> lock(registration_mutex_, std::defer_lock);
+                lock_registrations(lock);
                 callable();
             } catch (std::system_error&) {
                 // do nothing
             }
         }
     };
-
-    inline const void* handler_registration::handle() const { return handle_; }
-
-    inline void handler_registration::unregister() noexcept {
-        if (event_bus_ && handle_) {
-            event_bus_->remove_handler(*this);
-            handle_ = nullptr;
-        }
-    }
-
-    inline handler_registration::handler_registration(const void* handle, dp::event_bus* bus)
-        : handle_(handle), event_bus_(bus) {}
-
-    inline handler_registration::handler_registration(handler_registration&& other) noexcept
-        : handle_(std::exchange(other.handle_, nullptr)),
-          event_bus_(std::exchange(other.event_bus_, nullptr)) {}
-
-    inline handler_registration& handler_registration::operator=(
-        handler_registration&& other) noexcept {
-        handle_ = std::exchange(other.handle_, nullptr);
-        event_bus_ = std::exchange(other.event_bus_, nullptr);
-        return *this;
-    }
-
-    inline handler_registration::~handler_registration() { unregister(); }
 }  // namespace dp
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "detail/stable_type_tag.hpp"
+#include "event_bus.hpp"
+
+namespace dp {
+    /**
+     * @brief Converts events of a type to and from the bytes stored in an event_journal.
+     * @details Trivially copyable types are stored as they are. Specialize it for other types
+     * with
+     * - `static std::size_t size(const EventType&)`, the number of bytes write() stores,
+     * - `static void write(const EventType&, unsigned char* destination)`,
+     * - `static EventType read(const unsigned char* source, std::size_t size)`.
+     */
+    template <typename EventType, typename = void>
+    struct journal_codec {
+        static_assert(std::is_trivially_copyable_v<EventType>,
+                      "Specialize dp::journal_codec for event types that are not trivially "
+                      "copyable.");
+
+        static constexpr std::size_t size(const EventType&) noexcept { return sizeof(EventType); }
+
+        static void write(const EventType& evt, unsigned char* destination) noexcept {
+            std::memcpy(destination, &evt, sizeof(EventType));
+        }
+
+        static EventType read(const unsigned char* source, std::size_t) noexcept {
+            EventType evt;
+            std::memcpy(static_cast<void*>(&evt), source, sizeof(EventType));
+            return evt;
+        }
+    };
+
+    namespace detail {
+        struct journal_file_header {
+            std::uint64_t magic;
+            std::uint32_t version;
+            std::uint32_t reserved;
+        };
+
+        // followed by the payload, records start at multiples of 8 bytes
+        struct journal_record_header {
+            std::uint64_t tag;
+            // system_clock nanoseconds since the epoch
+            std::int64_t timestamp_ns;
+            std::uint32_t size;
+            // written last, a record with 0 here was not completely written
+            std::atomic<std::uint32_t> committed;
+        };
+
+        constexpr std::uint64_t journal_magic = 0x3130'6c6e'726a'7665ull;  // "evjrnl01"
+        constexpr std::uint32_t journal_version = 1;
+        constexpr std::size_t journal_records_offset = 64;
+
+        constexpr std::size_t journal_record_size(std::size_t payload_size) noexcept {
+            return (sizeof(journal_record_header) + payload_size + 7) / 8 * 8;
+        }
+
+        static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+                      "The journal needs lock free 32 bit atomics.");
+
+        inline void* map_file(int descriptor, std::size_t size, int protection) {
+            auto* address = ::mmap(nullptr, size, protection, MAP_SHARED, descriptor, 0);
+            if (address == MAP_FAILED) {
+                const auto error = errno;
+                ::close(descriptor);
+                throw std::system_error(error, std::generic_category(), "mmap");
+            }
+            return address;
+        }
+    }  // namespace detail
+
+    /**
+     * @brief Records events into an append only, memory mapped file for replay with
+     * journal_replayer.
+     * @details The file is sized to its capacity and mapped when the journal is created, so
+     * appending an event only reserves space with an atomic increment and copies the event into
+     * the mapping, without system calls or locks. Appends from several threads are safe. Every
+     * record carries the shared_event_tag of its type and a system_clock timestamp. Once the
+     * capacity is used up further events are dropped and counted. The destructor truncates the
+     * file to the recorded size.
+     */
+    class event_journal {
+      public:
+        /**
+         * @brief Create or overwrite a journal file.
+         * @param path Path of the file.
+         * @param capacity Maximum size of the file in bytes.
+         * @throws std::system_error if the file cannot be created or mapped.
+         */
+        event_journal(std::string path, std::size_t capacity) : path_(std::move(path)) {
+            capacity_ = std::max(capacity, detail::journal_records_offset);
+            const auto descriptor = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (descriptor < 0) {
+                throw std::system_error(errno, std::generic_category(), "open " + path_);
+            }
+            if (::ftruncate(descriptor, static_cast<off_t>(capacity_)) != 0) {
+                const auto error = errno;
+                ::close(descriptor);
+                throw std::system_error(error, std::generic_category(), "ftruncate " + path_);
+            }
+            data_ = static_cast<unsigned char*>(
+                detail::map_file(descriptor, capacity_, PROT_READ | PROT_WRITE));
+            descriptor_ = descriptor;
+
+            const detail::journal_file_header header{detail::journal_magic,
+                                                     detail::journal_version, 0};
+            std::memcpy(data_, &header, sizeof(header));
+        }
+
+        event_journal(const event_journal&) = delete;
+        event_journal& operator=(const event_journal&) = delete;
+
+        /**
+         * @brief Unmap the journal and truncate the file to the recorded size. Events must no
+         * longer be appended, remove the registrations of record() first.
+         */
+        ~event_journal() {
+            ::munmap(data_, capacity_);
+            [[maybe_unused]] const auto result =
+                ::ftruncate(descriptor_, static_cast<off_t>(size()));
+            ::close(descriptor_);
+        }
+
+        /**
+         * @brief Record every event of a type fired on a bus.
+         * @details Registers a handler with the highest priority, so events are recorded before
+         * any handler can consume them.
+         * @return The registration of the recording handler, recording stops when it is removed.
+         */
+        template <typename EventType>
+        [[nodiscard]] handler_registration record(event_bus& bus) {
+            return bus.register_handler<EventType>(
+                [this](const EventType& evt) { append(evt); }, std::numeric_limits<int>::max());
+        }
+
+        /**
+         * @brief Append an event to the journal.
+         * @return false if the journal is full and the event was dropped.
+         */
+        template <typename EventType>
+        bool append(const EventType& evt) {
+            using codec = journal_codec<EventType>;
+            const auto payload_size = codec::size(evt);
+            const auto record_size = detail::journal_record_size(payload_size);
+            const auto offset = end_.fetch_add(record_size, std::memory_order_relaxed);
+            if (offset + record_size > capacity_) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            auto* record = data_ + offset;
+            auto* header = ::new (static_cast<void*>(record)) detail::journal_record_header{
+                detail::shared_tag<EventType>(), now_ns(),
+                static_cast<std::uint32_t>(payload_size), {0}};
+            codec::write(evt, record + sizeof(detail::journal_record_header));
+            header->committed.store(1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Write the recorded events to the file, see msync. Recorded events also reach
+         * the file without it, once the kernel writes the pages back or the journal is destroyed.
+         */
+        void sync() {
+            if (::msync(data_, size(), MS_SYNC) != 0) {
+                throw std::system_error(errno, std::generic_category(), "msync " + path_);
+            }
+        }
+
+        /**
+         * @brief The number of bytes used by the header and the recorded events.
+         */
+        [[nodiscard]] std::size_t size() const noexcept {
+            return std::min(end_.load(std::memory_order_relaxed), capacity_);
+        }
+
+        /**
+         * @brief The number of events that were dropped because the journal was full.
+         */
+        [[nodiscard]] std::uint64_t dropped() const noexcept {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+      private:
+        static std::int64_t now_ns() noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        }
+
+        std::string path_;
+        std::size_t capacity_{0};
+        int descriptor_{-1};
+        unsigned char* data_{nullptr};
+        std::atomic<std::size_t> end_{detail::journal_records_offset};
+        std::atomic<std::uint64_t> dropped_{0};
+    };
+
+    /**
+     * @brief How journal_replayer::replay spaces the events it fires.
+     */
+    enum class replay_pacing {
+        /**
+         * @brief Fire the events back to back.
+         */
+        as_fast_as_possible,
+        /**
+         * @brief Wait between events as long as passed between them when they were recorded.
+         */
+        recorded
+    };
+
+    /**
+     * @brief Fires the events of a journal written by event_journal.
+     * @details Only events of types added with add_type() are fired, records of other types are
+     * skipped. Events are fired in the order their space in the journal was reserved.
+     */
+    class journal_replayer {
+      public:
+        /**
+         * @brief Map a journal file for reading.
+         * @throws std::system_error if the file cannot be mapped or is not a journal.
+         */
+        explicit journal_replayer(std::string path) : path_(std::move(path)) {
+            const auto descriptor = ::open(path_.c_str(), O_RDONLY);
+            if (descriptor < 0) {
+                throw std::system_error(errno, std::generic_category(), "open " + path_);
+            }
+            struct stat status {};
+            if (::fstat(descriptor, &status) != 0) {
+                const auto error = errno;
+                ::close(descriptor);
+                throw std::system_error(error, std::generic_category(), "fstat " + path_);
+            }
+            size_ = static_cast<std::size_t>(status.st_size);
+            detail::journal_file_header header{};
+            if (size_ < detail::journal_records_offset) {
+                ::close(descriptor);
+                throw invalid_journal();
+            }
+            data_ = static_cast<const unsigned char*>(
+                detail::map_file(descriptor, size_, PROT_READ));
+            ::close(descriptor);
+
+            std::memcpy(&header, data_, sizeof(header));
+            if (header.magic != detail::journal_magic ||
+                header.version != detail::journal_version) {
+                ::munmap(const_cast<unsigned char*>(data_), size_);
+                throw invalid_journal();
+            }
+        }
+
+        journal_replayer(const journal_replayer&) = delete;
+        journal_replayer& operator=(const journal_replayer&) = delete;
+
+        ~journal_replayer() { ::munmap(const_cast<unsigned char*>(data_), size_); }
+
+        /**
+         * @brief Fire the recorded events of a type when replaying.
+         */
+        template <typename EventType>
+        void add_type() {
+            decoders_[detail::shared_tag<EventType>()] = [](event_bus& bus,
+                                                           const unsigned char* payload,
+                                                           std::size_t size) {
+                bus.fire_event(journal_codec<EventType>::read(payload, size));
+            };
+        }
+
+        /**
+         * @brief Fire the recorded events on a bus.
+         * @param bus The bus to fire the events on.
+         * @param pacing Whether to keep the recorded time between events.
+         * @return The number of events fired.
+         */
+        std::size_t replay(event_bus& bus,
+                           replay_pacing pacing = replay_pacing::as_fast_as_possible) const {
+            std::size_t count{0};
+            const auto start = std::chrono::steady_clock::now();
+            std::int64_t first_timestamp{0};
+            for (auto offset = detail::journal_records_offset;
+                 offset + sizeof(detail::journal_record_header) <= size_;) {
+                const auto* header =
+                    reinterpret_cast<const detail::journal_record_header*>(data_ + offset);
+                const auto record_size = detail::journal_record_size(header->size);
+                if (header->committed.load(std::memory_order_acquire) == 0 ||
+                    offset + record_size > size_) {
+                    // the recording ended here
+                    break;
+                }
+                offset += record_size;
+
+                const auto found = decoders_.find(header->tag);
+                if (found == decoders_.end()) {
+                    continue;
+                }
+                if (pacing == replay_pacing::recorded) {
+                    if (count == 0) {
+                        first_timestamp = header->timestamp_ns;
+                    }
+                    // clock adjustments can make the recorded time go backwards
+                    const auto delay = std::chrono::nanoseconds(
+                        std::max<std::int64_t>(0, header->timestamp_ns - first_timestamp));
+                    std::this_thread::sleep_until(start + delay);
+                }
+                found->second(bus, reinterpret_cast<const unsigned char*>(header + 1),
+                              header->size);
+                ++count;
+            }
+            return count;
+        }
+
+      private:
+        using decoder = void (*)(event_bus&, const unsigned char*, std::size_t);
+
+        std::system_error invalid_journal() const {
+            return std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                     "not an event journal: " + path_);
+        }
+
+        std::string path_;
+        const unsigned char* data_{nullptr};
+        std::size_t size_{0};
+        std::unordered_map<std::uint64_t, decoder> decoders_;
+    };
+}  // namespace dp
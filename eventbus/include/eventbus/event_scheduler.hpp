@@ -0,0 +1,451 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "detail/inplace_handler.hpp"
+#include "event_bus.hpp"
+
+namespace dp {
+    class event_scheduler;
+
+    /**
+     * @brief A timer scheduled with an event_scheduler.
+     * @details This class is move constructible only. The timer is cancelled when the
+     * registration is destroyed, call release() to let it run on its own instead. The lifespan of
+     * this object must be as long or shorter than that of the scheduler.
+     */
+    class timer_registration {
+      public:
+        timer_registration(const timer_registration& other) = delete;
+        timer_registration(timer_registration&& other) noexcept;
+        timer_registration& operator=(const timer_registration& other) = delete;
+        timer_registration& operator=(timer_registration&& other) noexcept;
+        ~timer_registration();
+
+        /**
+         * @brief Cancel the timer. An event that is being fired already still reaches its
+         * handlers, but a periodic timer is not fired again.
+         * @return true if the timer was cancelled before it fired for the last time.
+         */
+        bool cancel() noexcept;
+
+        /**
+         * @brief Let the timer run, destroying this registration no longer cancels it.
+         */
+        void release() noexcept;
+
+      private:
+        timer_registration(event_scheduler* scheduler, std::uint32_t timer,
+                           std::uint32_t generation) noexcept
+            : scheduler_(scheduler), timer_(timer), generation_(generation) {}
+        friend class event_scheduler;
+
+        event_scheduler* scheduler_{nullptr};
+        std::uint32_t timer_{0};
+        std::uint32_t generation_{0};
+    };
+
+    /**
+     * @brief Fires events on an event_bus after a delay or at a fixed interval.
+     * @details Timers are kept in a hierarchical timer wheel of four levels of 256 slots. Each
+     * level covers 256 times the span of the level below it, so scheduling and cancelling a timer
+     * only link or unlink it from the list of one slot, no matter how many timers are pending. A
+     * timer is moved down a level at most three times before it fires.
+     *
+     * One driver thread advances the wheel one tick at a time and fires the events that are due,
+     * so events are fired at most about a tick late and handlers run on the driver thread. Timers
+     * due in the same tick fire in no particular order. The driver only wakes up for ticks with
+     * due timers and to move timers down a level. Handlers may schedule and cancel timers.
+     *
+     * The event_bus must outlive the scheduler. Timers still pending when the scheduler is
+     * destroyed are dropped.
+     */
+    class event_scheduler {
+      public:
+        /**
+         * @brief Create a scheduler and start its driver thread.
+         * @param bus The event bus events are fired on.
+         * @param tick The resolution of the timers, delays are rounded up to whole ticks.
+         * @param resource Memory resource for the timers and for events that do not fit a timer.
+         * Schedulers allocate from it concurrently, so it must be thread safe. It must outlive
+         * this object.
+         */
+        explicit event_scheduler(
+            event_bus& bus, std::chrono::nanoseconds tick = std::chrono::milliseconds(1),
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : bus_(bus),
+              tick_(std::max(tick, std::chrono::nanoseconds(1))),
+              resource_(resource),
+              timers_(resource),
+              free_timers_(resource),
+              due_(resource) {
+            slots_.fill(no_timer);
+            driver_ = std::thread([this]() { run(); });
+        }
+
+        event_scheduler(const event_scheduler&) = delete;
+        event_scheduler& operator=(const event_scheduler&) = delete;
+
+        ~event_scheduler() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wakeup_.notify_one();
+            driver_.join();
+        }
+
+        /**
+         * @brief Fire an event once after a delay.
+         * @tparam EventType The event type
+         * @param evt The event, it is copied or moved into the timer.
+         * @param delay The time from now until the event is fired.
+         * @return The registration of the timer, the timer is cancelled when it is destroyed.
+         */
+        template <typename EventType,
+                  typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<EventType>>>>
+        [[nodiscard]] timer_registration schedule_event(EventType&& evt,
+                                                        std::chrono::nanoseconds delay) {
+            return add_timer(make_fire_function(std::forward<EventType>(evt)), delay, 0);
+        }
+
+        /**
+         * @brief Fire an event at a fixed interval, first once the interval has passed.
+         * @details Firings are scheduled relative to the first one, so they do not drift. If the
+         * driver falls behind by more than an interval, the missed firings are skipped.
+         * @tparam EventType The event type
+         * @param evt The event, it is copied or moved into the timer and fired every time.
+         * @param interval The time between firings, at least one tick.
+         * @return The registration of the timer, the timer is cancelled when it is destroyed.
+         */
+        template <typename EventType,
+                  typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<EventType>>>>
+        [[nodiscard]] timer_registration schedule_periodic(EventType&& evt,
+                                                           std::chrono::nanoseconds interval) {
+            const auto interval_ticks = std::max<std::uint64_t>(1, to_ticks(interval));
+            return add_timer(make_fire_function(std::forward<EventType>(evt)), interval,
+                             interval_ticks);
+        }
+
+        /**
+         * @brief The number of timers that are scheduled and not cancelled.
+         */
+        [[nodiscard]] std::size_t pending() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return pending_;
+        }
+
+        /**
+         * @brief The resolution of the timers.
+         */
+        [[nodiscard]] std::chrono::nanoseconds tick() const noexcept { return tick_; }
+
+      private:
+        friend class timer_registration;
+
+        using fire_function = detail::inplace_handler<void(event_bus&)>;
+
+        static constexpr std::uint32_t no_timer = ~std::uint32_t{0};
+        static constexpr std::size_t slot_bits = 8;
+        static constexpr std::size_t slot_count = std::size_t{1} << slot_bits;
+        static constexpr std::uint64_t slot_mask = slot_count - 1;
+        static constexpr std::size_t level_count = 4;
+        // timers due later are parked in the furthest slot and placed again when it is reached
+        static constexpr std::uint64_t max_distance =
+            (std::uint64_t{1} << (slot_bits * level_count)) - 1;
+
+        enum class timer_state : std::uint8_t { unused, scheduled, firing, cancelled };
+
+        struct timer {
+            fire_function fire;
+            // tick the timer is due at
+            std::uint64_t expiry{0};
+            // ticks between firings, 0 for timers that fire once
+            std::uint64_t interval{0};
+            std::uint32_t generation{1};
+            // neighbors in the list of the slot the timer is linked into
+            std::uint32_t previous{no_timer};
+            std::uint32_t next{no_timer};
+            std::uint16_t slot{0};
+            timer_state state{timer_state::unused};
+        };
+
+        struct due_timer {
+            std::uint32_t index;
+            // std::deque keeps elements in place, so the driver can fire without the lock
+            timer* entry;
+        };
+
+        template <typename Event>
+        fire_function make_fire_function(Event&& evt) {
+            return fire_function(std::allocator_arg, resource_,
+                                 [stored = std::decay_t<Event>(std::forward<Event>(evt))](
+                                     event_bus& bus) { bus.fire_event(stored); });
+        }
+
+        timer_registration add_timer(fire_function&& fire, std::chrono::nanoseconds delay,
+                                     std::uint64_t interval) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::uint32_t index{0};
+            if (!free_timers_.empty()) {
+                index = free_timers_.back();
+                free_timers_.pop_back();
+            } else {
+                if (free_timers_.capacity() <= timers_.size()) {
+                    // room to free every timer, so cancelling never allocates
+                    free_timers_.reserve(std::max<std::size_t>(64, timers_.size() * 2));
+                }
+                index = static_cast<std::uint32_t>(timers_.size());
+                timers_.emplace_back();
+            }
+            if (pending_ == 0) {
+                // the wheel is empty and may not have been advanced in a while
+                base_ = std::max(base_, elapsed_ticks());
+            }
+            auto& entry = timers_[index];
+            entry.fire = std::move(fire);
+            entry.expiry = due_tick(delay);
+            entry.interval = interval;
+            entry.state = timer_state::scheduled;
+            link(index);
+            ++pending_;
+            if (entry.expiry < wake_tick_) {
+                // the driver sleeps past the new timer
+                wake_tick_ = entry.expiry;
+                wakeup_.notify_one();
+            }
+            return {this, index, entry.generation};
+        }
+
+        bool cancel(std::uint32_t index, std::uint32_t generation) noexcept {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& entry = timers_[index];
+            if (entry.generation != generation) {
+                // fired for the last time or cancelled before
+                return false;
+            }
+            if (entry.state == timer_state::scheduled) {
+                unlink(index);
+                release_timer(index);
+                return true;
+            }
+            if (entry.state == timer_state::firing) {
+                // released by the driver once the event was fired
+                entry.state = timer_state::cancelled;
+                --pending_;
+                return entry.interval != 0;
+            }
+            return false;
+        }
+
+        void release_timer(std::uint32_t index) noexcept {
+            auto& entry = timers_[index];
+            if (entry.state != timer_state::cancelled) {
+                --pending_;
+            }
+            entry.fire = nullptr;
+            entry.state = timer_state::unused;
+            ++entry.generation;
+            free_timers_.push_back(index);
+        }
+
+        void link(std::uint32_t index) noexcept {
+            auto& entry = timers_[index];
+            const auto distance = std::min(std::max(entry.expiry, base_) - base_, max_distance);
+            std::size_t level{0};
+            while (level + 1 < level_count &&
+                   distance >= (std::uint64_t{1} << (slot_bits * (level + 1)))) {
+                ++level;
+            }
+            const auto slot_tick = base_ + distance;
+            const auto slot =
+                level * slot_count + ((slot_tick >> (slot_bits * level)) & slot_mask);
+            entry.slot = static_cast<std::uint16_t>(slot);
+            entry.previous = no_timer;
+            entry.next = slots_[slot];
+            if (entry.next != no_timer) {
+                timers_[entry.next].previous = index;
+            }
+            slots_[slot] = index;
+        }
+
+        void unlink(std::uint32_t index) noexcept {
+            auto& entry = timers_[index];
+            if (entry.previous != no_timer) {
+                timers_[entry.previous].next = entry.next;
+            } else {
+                slots_[entry.slot] = entry.next;
+            }
+            if (entry.next != no_timer) {
+                timers_[entry.next].previous = entry.previous;
+            }
+        }
+
+        // link the timers of a slot again, which moves them to the levels below
+        void cascade(std::size_t slot) noexcept {
+            auto index = std::exchange(slots_[slot], no_timer);
+            while (index != no_timer) {
+                const auto next = timers_[index].next;
+                link(index);
+                index = next;
+            }
+        }
+
+        // take the timers due at tick base_ out of the wheel and move on to the next tick
+        void advance() {
+            const auto position = base_ & slot_mask;
+            if (position == 0) {
+                for (std::size_t level = 1; level < level_count; ++level) {
+                    const auto slot = (base_ >> (slot_bits * level)) & slot_mask;
+                    cascade(level * slot_count + slot);
+                    if (slot != 0) {
+                        break;
+                    }
+                }
+            }
+            auto index = std::exchange(slots_[position], no_timer);
+            while (index != no_timer) {
+                auto& entry = timers_[index];
+                entry.state = timer_state::firing;
+                due_.push_back({index, &entry});
+                index = entry.next;
+            }
+            ++base_;
+        }
+
+        void fire_due(std::unique_lock<std::mutex>& lock) {
+            lock.unlock();
+            for (const auto& due : due_) {
+                due.entry->fire(bus_);
+            }
+            lock.lock();
+            for (const auto& due : due_) {
+                auto& entry = *due.entry;
+                if (entry.state == timer_state::cancelled || entry.interval == 0) {
+                    release_timer(due.index);
+                    continue;
+                }
+                entry.expiry += entry.interval;
+                if (entry.expiry < base_) {
+                    // skip the firings that were missed
+                    const auto missed = (base_ - entry.expiry + entry.interval - 1) /
+                                        entry.interval;
+                    entry.expiry += missed * entry.interval;
+                }
+                entry.state = timer_state::scheduled;
+                link(due.index);
+            }
+            due_.clear();
+        }
+
+        // the first tick after base_ with due timers or timers to move down a level
+        std::uint64_t next_work_tick() const noexcept {
+            const auto next_cascade = (base_ | slot_mask) + 1;
+            for (auto tick = base_; tick < next_cascade; ++tick) {
+                if (slots_[tick & slot_mask] != no_timer) {
+                    return tick;
+                }
+            }
+            return next_cascade;
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stopping_) {
+                const auto current = elapsed_ticks();
+                if (pending_ == 0) {
+                    // nothing to move or fire, the wheel can skip ahead
+                    base_ = std::max(base_, current);
+                    wake_tick_ = std::numeric_limits<std::uint64_t>::max();
+                    wakeup_.wait(lock, [this]() { return stopping_ || pending_ != 0; });
+                    continue;
+                }
+                while (base_ <= current && !stopping_) {
+                    advance();
+                    if (!due_.empty()) {
+                        fire_due(lock);
+                    }
+                }
+                wake_tick_ = next_work_tick();
+                wakeup_.wait_until(lock, start_ + tick_ * static_cast<std::int64_t>(wake_tick_));
+            }
+        }
+
+        std::uint64_t to_ticks(std::chrono::nanoseconds duration) const noexcept {
+            const auto count = std::max<std::int64_t>(0, duration.count());
+            return static_cast<std::uint64_t>((count + tick_.count() - 1) / tick_.count());
+        }
+
+        // the first tick that starts at or after now plus the delay
+        std::uint64_t due_tick(std::chrono::nanoseconds delay) const noexcept {
+            return to_ticks(std::chrono::steady_clock::now() - start_ +
+                            std::max(delay, std::chrono::nanoseconds(0)));
+        }
+
+        std::uint64_t elapsed_ticks() const noexcept {
+            return static_cast<std::uint64_t>((std::chrono::steady_clock::now() - start_) /
+                                              tick_);
+        }
+
+        event_bus& bus_;
+        const std::chrono::nanoseconds tick_;
+        std::pmr::memory_resource* resource_;
+        const std::chrono::steady_clock::time_point start_{std::chrono::steady_clock::now()};
+
+        mutable std::mutex mutex_;
+        std::condition_variable wakeup_;
+        bool stopping_{false};
+        // timers are addressed by index, freed ones are reused
+        std::pmr::deque<timer> timers_;
+        std::pmr::vector<std::uint32_t> free_timers_;
+        // first timer of the list of every slot, level by level
+        std::array<std::uint32_t, level_count * slot_count> slots_{};
+        // the next tick to process
+        std::uint64_t base_{0};
+        // the tick the driver sleeps until
+        std::uint64_t wake_tick_{std::numeric_limits<std::uint64_t>::max()};
+        std::size_t pending_{0};
+        std::pmr::vector<due_timer> due_;
+        std::thread driver_;
+    };
+
+    inline timer_registration::timer_registration(timer_registration&& other) noexcept
+        : scheduler_(std::exchange(other.scheduler_, nullptr)),
+          timer_(other.timer_),
+          generation_(other.generation_) {}
+
+    inline timer_registration& timer_registration::operator=(
+        timer_registration&& other) noexcept {
+        if (this != &other) {
+            cancel();
+            scheduler_ = std::exchange(other.scheduler_, nullptr);
+            timer_ = other.timer_;
+            generation_ = other.generation_;
+        }
+        return *this;
+    }
+
+    inline timer_registration::~timer_registration() { cancel(); }
+
+    inline bool timer_registration::cancel() noexcept {
+        if (!scheduler_) {
+            return false;
+        }
+        return std::exchange(scheduler_, nullptr)->cancel(timer_, generation_);
+    }
+
+    inline void timer_registration::release() noexcept { scheduler_ = nullptr; }
+}  // namespace dp
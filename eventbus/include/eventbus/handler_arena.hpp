@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+
+namespace dp {
+    namespace detail {
+        template <std::size_t BufferSize>
+        struct arena_buffer {
+            alignas(std::max_align_t) std::array<std::byte, BufferSize> buffer_;
+        };
+    }  // namespace detail
+
+    /**
+     * @brief A memory arena for an event_bus whose handlers are registered once at startup.
+     * @details Allocations are served from a buffer of BufferSize bytes that is part of this
+     * object and fall back to the upstream resource once the buffer is exhausted. Memory is only
+     * released when the arena is destroyed, so registration churn makes it grow. The arena is not
+     * thread safe, which is fine for event_bus handler storage since all of its allocations are
+     * made while holding the registration lock. The arena must outlive the event bus.
+     *
+     * @code
+     * dp::handler_arena<> arena;
+     * dp::event_bus evt_bus(&arena);
+     * @endcode
+     * @tparam BufferSize Size of the inline buffer in bytes.
+     */
+    template <std::size_t BufferSize = 16 * 1024>
+    class handler_arena : private detail::arena_buffer<BufferSize>,
+                          public std::pmr::monotonic_buffer_resource {
+      public:
+        explicit handler_arena(
+            std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+            : std::pmr::monotonic_buffer_resource(this->buffer_.data(), this->buffer_.size(),
+                                                  upstream) {}
+
+        handler_arena(const handler_arena&) = delete;
+        handler_arena& operator=(const handler_arena&) = delete;
+    };
+}  // namespace dp
@@ -0,0 +1,128 @@
+#pragma once
+
+#ifndef EVENTBUS_HAS_COROUTINES
+#    if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#        if __has_include(<coroutine>)
+/**
+ * 1 if C++20 coroutines are available, which enables event_bus::next(). Detected automatically,
+ * define it to 0 to turn the coroutine support off.
+ */
+#            define EVENTBUS_HAS_COROUTINES 1
+#        endif
+#    endif
+#endif
+#ifndef EVENTBUS_HAS_COROUTINES
+#    define EVENTBUS_HAS_COROUTINES 0
+#endif
+
+#if EVENTBUS_HAS_COROUTINES
+
+#    include <atomic>
+#    include <coroutine>
+#    include <memory>
+#    include <optional>
+#    include <utility>
+
+#    include "registration_handle.hpp"
+
+namespace dp {
+    /**
+     * @brief Resumes a coroutine on the thread that fired the event it waited for.
+     */
+    struct inline_executor {
+        void operator()(std::coroutine_handle<> handle) const { handle.resume(); }
+    };
+
+    namespace detail {
+        struct any_event {
+            template <typename EventType>
+            constexpr bool operator()(const EventType&) const noexcept {
+                return true;
+            }
+        };
+    }  // namespace detail
+
+    /**
+     * @brief Awaitable returned by event_bus::next(), resumes the awaiting coroutine with a copy
+     * of the next event that matches a predicate.
+     * @details Awaiting registers a handler that removes itself once an event matched, the wait
+     * does not block a thread. Waits are only fulfilled once: if events that match are fired
+     * concurrently, one of them wins and the others are not delivered. Destroying a coroutine that
+     * is suspended on the awaitable cancels the wait, which must not race with firing a matching
+     * event. The predicate may be called concurrently when events are fired from several threads.
+     * @tparam Bus The event bus type.
+     * @tparam EventType The event type to wait for.
+     * @tparam Predicate Called with `const EventType&`, returns whether to take the event.
+     * @tparam Executor Called with the coroutine handle to resume the coroutine, by default it is
+     * resumed inside fire_event.
+     */
+    template <typename Bus, typename EventType, typename Predicate, typename Executor>
+    class next_event {
+      public:
+        next_event(Bus& bus, Predicate predicate, Executor executor)
+            : bus_(&bus), predicate_(std::move(predicate)), executor_(std::move(executor)) {}
+
+        next_event(const next_event&) = delete;
+        next_event& operator=(const next_event&) = delete;
+        next_event(next_event&&) noexcept = default;
+        next_event& operator=(next_event&&) noexcept = default;
+
+        ~next_event() {
+            if (state_) {
+                // cancel a wait that was not fulfilled, handler calls still in flight see this
+                state_->claimed.store(true, std::memory_order_release);
+            }
+        }
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            // shared with the handler, which can be called while a dispatch that started before
+            // the handler was removed is still running
+            state_ = std::make_shared<wait_state>(std::move(predicate_), std::move(executor_));
+            state_->handle = handle;
+            registration_.emplace(bus_->template register_handler<EventType>(
+                [state = state_](const EventType& evt) { state->offer(evt); }));
+            // an event may already have matched on another thread, then resume right away
+            return !state_->handoff.exchange(true, std::memory_order_acq_rel);
+        }
+
+        EventType await_resume() {
+            registration_.reset();
+            return std::move(*state_->event);
+        }
+
+      private:
+        struct wait_state {
+            wait_state(Predicate&& match, Executor&& resume)
+                : predicate(std::move(match)), executor(std::move(resume)) {}
+
+            void offer(const EventType& evt) {
+                if (claimed.load(std::memory_order_acquire) || !predicate(evt) ||
+                    claimed.exchange(true, std::memory_order_acq_rel)) {
+                    return;
+                }
+                event.emplace(evt);
+                // whichever of this and await_suspend() comes second resumes the coroutine
+                if (handoff.exchange(true, std::memory_order_acq_rel)) {
+                    executor(handle);
+                }
+            }
+
+            Predicate predicate;
+            Executor executor;
+            std::coroutine_handle<> handle;
+            std::atomic<bool> claimed{false};
+            std::atomic<bool> handoff{false};
+            std::optional<EventType> event;
+        };
+
+        Bus* bus_;
+        Predicate predicate_;
+        Executor executor_;
+        std::shared_ptr<wait_state> state_;
+        std::optional<handler_registration> registration_;
+    };
+}  // namespace dp
+
+#endif
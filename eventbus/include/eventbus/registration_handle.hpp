@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include "detail/type_id.hpp"
+
+namespace dp {
+    class event_bus;
+    template <typename... Events>
+    class static_event_bus;
+
+    /**
+     * @brief Identifies a single handler registered with an event_bus.
+     * @details The slot indexes the bus's registration table. The generation is bumped every time
+     * the slot is released, so a stale handle never matches a handler that later reuses the slot.
+     */
+    struct registration_handle {
+        detail::type_id_t event_type{0};
+        std::uint32_t slot{0};
+        std::uint32_t generation{0};
+
+        [[nodiscard]] bool valid() const noexcept { return generation != 0; }
+    };
+
+    /**
+     * @brief A registration handle for a particular handler of an event type.
+     * @details This class is move constructible only. It also assumed that the lifespan of this
+     * object will be as long or shorter than that of the event bus. This class is move
+     * constructible for that reason, but there are still some cases where you can run into life
+     * time issues.
+     */
+    class handler_registration {
+        using remove_function = bool (*)(void* bus, const handler_registration& registration);
+
+        registration_handle handle_{};
+        void* event_bus_{nullptr};
+        remove_function remove_{nullptr};
+
+      public:
+        handler_registration(const handler_registration& other) = delete;
+        handler_registration(handler_registration&& other) noexcept;
+        handler_registration& operator=(const handler_registration& other) = delete;
+        handler_registration& operator=(handler_registration&& other) noexcept;
+        ~handler_registration();
+
+        /**
+         * @brief The underlying handle.
+         */
+        [[nodiscard]] const registration_handle& handle() const;
+
+        /**
+         * @brief Unregister this handler from the event bus.
+         */
+        void unregister() noexcept;
+
+      protected:
+        handler_registration(registration_handle handle, void* bus, remove_function remove);
+        friend class event_bus;
+        template <typename... Events>
+        friend class static_event_bus;
+    };
+
+    inline const registration_handle& handler_registration::handle() const { return handle_; }
+
+    inline void handler_registration::unregister() noexcept {
+        if (event_bus_ && handle_.valid()) {
+            remove_(event_bus_, *this);
+            handle_ = {};
+        }
+    }
+
+    inline handler_registration::handler_registration(registration_handle handle, void* bus,
+                                                      remove_function remove)
+        : handle_(handle), event_bus_(bus), remove_(remove) {}
+
+    inline handler_registration::handler_registration(handler_registration&& other) noexcept
+        : handle_(std::exchange(other.handle_, {})),
+          event_bus_(std::exchange(other.event_bus_, nullptr)),
+          remove_(std::exchange(other.remove_, nullptr)) {}
+
+    inline handler_registration& handler_registration::operator=(
+        handler_registration&& other) noexcept {
+        handle_ = std::exchange(other.handle_, {});
+        event_bus_ = std::exchange(other.event_bus_, nullptr);
+        remove_ = std::exchange(other.remove_, nullptr);
+        return *this;
+    }
+
+    inline handler_registration::~handler_registration() { unregister(); }
+}  // namespace dp
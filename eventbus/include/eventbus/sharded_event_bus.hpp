@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "detail/type_id.hpp"
+#include "event_bus.hpp"
+
+namespace dp {
+    /**
+     * @brief An event bus that partitions its handlers and locks by event type.
+     * @details Every event type is assigned to one of several shards, each an independent
+     * event_bus with its own registration lock, handler storage and reclamation. Registering or
+     * removing handlers of one type therefore only contends with event types of the same shard,
+     * firing an event never waits for registrations of types in other shards. Event type ids are
+     * dense, so with at least as many shards as frequently used event types every type gets a
+     * shard of its own.
+     *
+     * The surface matches event_bus, except for declare_base(), since the handlers of a base
+     * type may live in another shard.
+     */
+    class sharded_event_bus {
+      public:
+        /**
+         * @brief Create a sharded event bus.
+         * @param shard_count Number of shards, at least one. Defaults to the number of hardware
+         * threads.
+         * @param mode How fire_event synchronizes with handler registration in every shard.
+         * @param resource Memory resource for the handler storage. The shards allocate from it
+         * concurrently, so it must be thread safe. It must outlive the event bus.
+         */
+        explicit sharded_event_bus(
+            std::size_t shard_count = std::thread::hardware_concurrency(),
+            dispatch_mode mode = dispatch_mode::locked,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+            shard_count = std::max<std::size_t>(1, shard_count);
+            shards_.reserve(shard_count);
+            for (std::size_t i = 0; i < shard_count; ++i) {
+                shards_.push_back(std::make_unique<shard>(mode, resource));
+            }
+        }
+
+        sharded_event_bus(const sharded_event_bus&) = delete;
+        sharded_event_bus& operator=(const sharded_event_bus&) = delete;
+
+        /**
+         * @brief Register an event handler, see event_bus::register_handler() for the overloads.
+         */
+        template <typename EventType, typename... Args>
+        [[nodiscard]] handler_registration register_handler(Args&&... args) {
+            return shard_for<EventType>().template register_handler<EventType>(
+                std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Register a batch handler, see event_bus::register_batch_handler().
+         */
+        template <typename EventType, typename... Args>
+        [[nodiscard]] handler_registration register_batch_handler(Args&&... args) {
+            return shard_for<EventType>().template register_batch_handler<EventType>(
+                std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Fire an event to the handlers of its type, see event_bus::fire_event().
+         */
+        template <typename EventType,
+                  typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<EventType>>>>
+        void fire_event(EventType&& evt) noexcept {
+            shard_for<std::decay_t<EventType>>().fire_event(std::forward<EventType>(evt));
+        }
+
+        /**
+         * @brief Fire a batch of events of the same type, see event_bus::fire_events().
+         */
+        template <typename EventType>
+        void fire_events(const EventType* events, std::size_t count) noexcept {
+            shard_for<EventType>().fire_events(events, count);
+        }
+
+        /**
+         * @brief Fire all events of a contiguous container, such as a std::vector or std::array.
+         */
+        template <typename Container,
+                  typename = decltype(std::data(std::declval<const Container&>()))>
+        void fire_events(const Container& events) noexcept {
+            fire_events(std::data(events), std::size(events));
+        }
+
+#if EVENTBUS_HAS_COROUTINES
+        /**
+         * @brief Wait for the next event of a type in a C++20 coroutine, see event_bus::next().
+         */
+        template <typename EventType, typename Predicate = detail::any_event,
+                  typename Executor = inline_executor>
+        [[nodiscard]] next_event<sharded_event_bus, EventType, Predicate, Executor> next(
+            Predicate predicate = {}, Executor executor = {}) {
+            return {*this, std::move(predicate), std::move(executor)};
+        }
+#endif
+
+        /**
+         * @brief Remove a handler that was registered with this bus.
+         * @return true if the handler was removed.
+         */
+        bool remove_handler(const handler_registration& registration) noexcept {
+            const auto event_type = registration.handle().event_type;
+            return shards_[event_type % shards_.size()]->bus.remove_handler(registration);
+        }
+
+        /**
+         * @brief Remove all handlers from every shard.
+         */
+        void remove_handlers() noexcept {
+            for (auto& s : shards_) {
+                s->bus.remove_handlers();
+            }
+        }
+
+        /**
+         * @brief The number of handlers of all shards.
+         */
+        [[nodiscard]] std::size_t handler_count() noexcept {
+            std::size_t count{0};
+            for (auto& s : shards_) {
+                count += s->bus.handler_count();
+            }
+            return count;
+        }
+
+        /**
+         * @brief The number of shards.
+         */
+        [[nodiscard]] std::size_t shard_count() const noexcept { return shards_.size(); }
+
+        /**
+         * @brief The shard the handlers of an event type are stored in.
+         */
+        template <typename EventType>
+        [[nodiscard]] std::size_t shard_index() const noexcept {
+            return detail::type_id<EventType>() % shards_.size();
+        }
+
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+        /**
+         * @brief Statistics of all shards, see event_bus::stats(). The lock wait histograms are
+         * the sums over all shards.
+         */
+        [[nodiscard]] event_bus_stats stats() {
+            event_bus_stats result;
+            for (auto& s : shards_) {
+                auto shard_stats = s->bus.stats();
+                add(result.shared_lock_wait, shard_stats.shared_lock_wait);
+                add(result.exclusive_lock_wait, shard_stats.exclusive_lock_wait);
+                std::move(shard_stats.event_types.begin(), shard_stats.event_types.end(),
+                          std::back_inserter(result.event_types));
+            }
+            std::sort(result.event_types.begin(), result.event_types.end(),
+                      [](const auto& lhs, const auto& rhs) {
+                          return lhs.event_type < rhs.event_type;
+                      });
+            return result;
+        }
+#endif
+
+      private:
+        // each shard on its own cache lines so their locks do not false share
+        struct alignas(64) shard {
+            shard(dispatch_mode mode, std::pmr::memory_resource* resource) : bus(mode, resource) {}
+            event_bus bus;
+        };
+
+        template <typename EventType>
+        event_bus& shard_for() noexcept {
+            return shards_[shard_index<EventType>()]->bus;
+        }
+
+#if EVENTBUS_ENABLE_INSTRUMENTATION
+        static void add(latency_histogram& total, const latency_histogram& histogram) noexcept {
+            for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i) {
+                total.buckets[i] += histogram.buckets[i];
+            }
+            total.total_ns += histogram.total_ns;
+        }
+#endif
+
+        std::vector<std::unique_ptr<shard>> shards_;
+    };
+}  // namespace dp
@@ -0,0 +1,368 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "detail/stable_type_tag.hpp"
+#include "event_bus.hpp"
+
+#ifndef EVENTBUS_SHM_PAYLOAD_SIZE
+/**
+ * Size in bytes of the largest event a shared_memory_bus can carry. Every slot of the ring buffer
+ * has room for one event of this size, with the header the default makes a slot 256 bytes. All
+ * processes attached to a bus must use the same value.
+ */
+#    define EVENTBUS_SHM_PAYLOAD_SIZE 232
+#endif
+
+namespace dp {
+    /**
+     * @brief An event bus whose events reach the handlers of every process attached to the same
+     * named shared memory segment.
+     * @details Fired events are copied into a ring buffer in POSIX shared memory, which every
+     * attached bus reads, the kernel is only involved when a process attaches. Writers claim
+     * slots with an atomic increment and publish them with a per slot sequence number, readers
+     * never block writers. Only trivially copyable events of at most EVENTBUS_SHM_PAYLOAD_SIZE
+     * bytes can be fired.
+     *
+     * Events are delivered by poll(), on the thread that calls it, to the handlers registered on
+     * this bus, including events fired by this process. A bus only sees events fired after it was
+     * attached. A reader that falls more than a full ring behind misses the overwritten events,
+     * which are counted by lost_events(). A process that dies while writing a slot stalls the
+     * writers that wrap around to that slot.
+     */
+    class shared_memory_bus {
+      public:
+        /**
+         * @brief Attach to the shared memory segment with the given name, creating it if it does
+         * not exist yet.
+         * @param name Name of the segment, such as "/prices", see shm_open.
+         * @param capacity Number of slots of the ring buffer, rounded up to a power of two. Only
+         * used by the process that creates the segment.
+         * @param mode How the local handlers are called, see event_bus.
+         * @throws std::system_error if the segment cannot be created or mapped.
+         */
+        explicit shared_memory_bus(std::string name, std::size_t capacity = 4096,
+                                   dispatch_mode mode = dispatch_mode::locked)
+            : name_(std::move(name)), local_bus_(mode) {
+            attach(capacity);
+            next_ = header_->tail.load(std::memory_order_acquire);
+        }
+
+        shared_memory_bus(const shared_memory_bus&) = delete;
+        shared_memory_bus& operator=(const shared_memory_bus&) = delete;
+
+        /**
+         * @brief Detach from the segment. The segment itself lives on until it is removed.
+         */
+        ~shared_memory_bus() { ::munmap(static_cast<void*>(header_), mapped_size_); }
+
+        /**
+         * @brief Remove the named segment. Attached processes keep their mapping, but buses
+         * created later with the same name use a new segment.
+         * @return false if no segment with that name exists.
+         */
+        static bool remove(const std::string& name) noexcept {
+            return ::shm_unlink(name.c_str()) == 0;
+        }
+
+        /**
+         * @brief Register a handler for events fired by any attached process, see
+         * event_bus::register_handler() for the overloads.
+         */
+        template <typename EventType, typename... Args>
+        [[nodiscard]] handler_registration register_handler(Args&&... args) {
+            add_decoder<EventType>();
+            return local_bus_.register_handler<EventType>(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Remove a handler that was registered with this bus.
+         * @return true if the handler was removed.
+         */
+        bool remove_handler(const handler_registration& registration) noexcept {
+            return local_bus_.remove_handler(registration);
+        }
+
+        /**
+         * @brief The number of handlers registered with this bus.
+         */
+        [[nodiscard]] std::size_t handler_count() noexcept { return local_bus_.handler_count(); }
+
+        /**
+         * @brief Publish an event to every attached process.
+         * @details Waits if the slot it claims is still being written by a writer one full ring
+         * ahead, which only happens when the ring is much smaller than the number of concurrent
+         * writers.
+         */
+        template <typename EventType>
+        void fire_event(const EventType& evt) noexcept {
+            static_assert(std::is_trivially_copyable_v<EventType>,
+                          "Events of a shared_memory_bus must be trivially copyable.");
+            static_assert(sizeof(EventType) <= EVENTBUS_SHM_PAYLOAD_SIZE,
+                          "The event is larger than EVENTBUS_SHM_PAYLOAD_SIZE.");
+
+            const auto sequence = header_->tail.fetch_add(1, std::memory_order_relaxed);
+            auto& target = slots_[sequence & mask_];
+            // the previous lap must be done writing this slot
+            const auto previous = sequence >= capacity_ ? committed(sequence - capacity_) : 0;
+            while (target.sequence.load(std::memory_order_acquire) != previous) {
+                std::this_thread::yield();
+            }
+            target.sequence.store(committed(sequence) - 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            std::uint64_t words[slot::word_count]{};
+            std::memcpy(words, &evt, sizeof(EventType));
+            target.tag.store(detail::shared_tag<EventType>(), std::memory_order_relaxed);
+            target.size.store(sizeof(EventType), std::memory_order_relaxed);
+            for (std::size_t i = 0; i < (sizeof(EventType) + 7) / 8; ++i) {
+                target.words[i].store(words[i], std::memory_order_relaxed);
+            }
+            target.sequence.store(committed(sequence), std::memory_order_release);
+        }
+
+        /**
+         * @brief Dispatch the events fired since the last call to the handlers of this bus.
+         * @details Must not be called from a handler. Concurrent calls are serialized.
+         * @param max_events Stop after this many events.
+         * @return The number of events read from the ring, including events without handlers.
+         */
+        std::size_t poll(std::size_t max_events = static_cast<std::size_t>(-1)) {
+            std::lock_guard<std::mutex> lock(poll_mutex_);
+            const auto decoders = current_decoders();
+            std::size_t count{0};
+            std::uint64_t words[slot::word_count];
+            while (count < max_events) {
+                auto& source = slots_[next_ & mask_];
+                const auto sequence = source.sequence.load(std::memory_order_acquire);
+                if (sequence < committed(next_)) {
+                    // not written yet
+                    break;
+                }
+                const auto tag = source.tag.load(std::memory_order_relaxed);
+                const auto size = std::min<std::uint64_t>(
+                    source.size.load(std::memory_order_relaxed), EVENTBUS_SHM_PAYLOAD_SIZE);
+                for (std::size_t i = 0; i < (size + 7) / 8; ++i) {
+                    words[i] = source.words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence != committed(next_) ||
+                    source.sequence.load(std::memory_order_relaxed) != sequence) {
+                    // overwritten by a writer one lap ahead, skip to the oldest slot still intact
+                    const auto tail = header_->tail.load(std::memory_order_acquire);
+                    const auto oldest =
+                        std::max(tail >= capacity_ ? tail - capacity_ : 0, next_ + 1);
+                    lost_ += oldest - next_;
+                    next_ = oldest;
+                    continue;
+                }
+                ++next_;
+                ++count;
+                if (decoders) {
+                    if (auto found = decoders->find(tag); found != decoders->end()) {
+                        found->second(local_bus_, words, size);
+                    }
+                }
+            }
+            return count;
+        }
+
+        /**
+         * @brief The number of events this bus missed because it fell a full ring behind.
+         */
+        [[nodiscard]] std::uint64_t lost_events() const {
+            std::lock_guard<std::mutex> lock(poll_mutex_);
+            return lost_;
+        }
+
+        /**
+         * @brief The number of slots of the ring buffer.
+         */
+        [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+
+      private:
+        static constexpr std::uint64_t magic = 0x6576656e74627573ull;  // "eventbus"
+        static constexpr std::uint32_t layout_version = 1;
+
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                      "Shared memory needs lock free 64 bit atomics.");
+
+        struct slot {
+            static constexpr std::size_t word_count = (EVENTBUS_SHM_PAYLOAD_SIZE + 7) / 8;
+            // committed(n) once event n is written, committed(n) - 1 while it is written
+            std::atomic<std::uint64_t> sequence;
+            std::atomic<std::uint64_t> tag;
+            std::atomic<std::uint64_t> size;
+            std::atomic<std::uint64_t> words[word_count];
+        };
+
+        struct header {
+            std::atomic<std::uint64_t> initialized;
+            std::uint32_t version;
+            std::uint32_t payload_size;
+            std::uint64_t capacity;
+            // claimed by writers, on its own cache line
+            alignas(64) std::atomic<std::uint64_t> tail;
+        };
+
+        static constexpr std::size_t slots_offset = (sizeof(header) + 63) / 64 * 64;
+
+        using decoder = void (*)(event_bus&, const std::uint64_t*, std::uint64_t);
+        using decoder_map = std::unordered_map<std::uint64_t, decoder>;
+
+        static constexpr std::uint64_t committed(std::uint64_t sequence) noexcept {
+            return (sequence + 1) * 2;
+        }
+
+        template <typename EventType>
+        static void decode(event_bus& bus, const std::uint64_t* words, std::uint64_t size) {
+            if (size != sizeof(EventType)) {
+                return;
+            }
+            EventType evt;
+            // the event may have default member initializers, add_decoder() checks it is
+            // trivially copyable
+            std::memcpy(static_cast<void*>(&evt), words, sizeof(EventType));
+            bus.fire_event(evt);
+        }
+
+        template <typename EventType>
+        void add_decoder() {
+            static_assert(std::is_trivially_copyable_v<EventType> &&
+                              std::is_default_constructible_v<EventType>,
+                          "Events of a shared_memory_bus must be trivially copyable and default "
+                          "constructible.");
+            constexpr auto tag = detail::shared_tag<EventType>();
+            std::lock_guard<std::mutex> lock(decoders_mutex_);
+            if (decoders_ && decoders_->count(tag) != 0) {
+                return;
+            }
+            // copied on write, so poll() only holds the lock to take a reference
+            auto updated = decoders_ ? std::make_shared<decoder_map>(*decoders_)
+                                     : std::make_shared<decoder_map>();
+            updated->emplace(tag, &decode<EventType>);
+            decoders_ = std::move(updated);
+        }
+
+        std::shared_ptr<const decoder_map> current_decoders() {
+            std::lock_guard<std::mutex> lock(decoders_mutex_);
+            return decoders_;
+        }
+
+        void attach(std::size_t requested_capacity) {
+            std::size_t capacity = 2;
+            while (capacity < requested_capacity) {
+                capacity *= 2;
+            }
+
+            bool created{true};
+            auto descriptor = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (descriptor < 0 && errno == EEXIST) {
+                created = false;
+                descriptor = ::shm_open(name_.c_str(), O_RDWR, 0600);
+            }
+            if (descriptor < 0) {
+                throw std::system_error(errno, std::generic_category(), "shm_open " + name_);
+            }
+
+            try {
+                if (created) {
+                    mapped_size_ = slots_offset + capacity * sizeof(slot);
+                    if (::ftruncate(descriptor, static_cast<off_t>(mapped_size_)) != 0) {
+                        throw std::system_error(errno, std::generic_category(), "ftruncate");
+                    }
+                } else {
+                    mapped_size_ = wait_for_size(descriptor);
+                }
+                map(descriptor);
+            } catch (...) {
+                ::close(descriptor);
+                if (created) {
+                    ::shm_unlink(name_.c_str());
+                }
+                throw;
+            }
+            ::close(descriptor);
+
+            if (created) {
+                // a new segment is zero filled, which is the initial state of every slot
+                header_->version = layout_version;
+                header_->payload_size = EVENTBUS_SHM_PAYLOAD_SIZE;
+                header_->capacity = capacity;
+                header_->initialized.store(magic, std::memory_order_release);
+            } else {
+                while (header_->initialized.load(std::memory_order_acquire) != magic) {
+                    std::this_thread::yield();
+                }
+                if (header_->version != layout_version ||
+                    header_->payload_size != EVENTBUS_SHM_PAYLOAD_SIZE ||
+                    slots_offset + header_->capacity * sizeof(slot) > mapped_size_) {
+                    ::munmap(static_cast<void*>(header_), mapped_size_);
+                    throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                            "incompatible shared memory segment " + name_);
+                }
+            }
+            capacity_ = header_->capacity;
+            mask_ = capacity_ - 1;
+            slots_ = reinterpret_cast<slot*>(reinterpret_cast<unsigned char*>(header_) +
+                                             slots_offset);
+        }
+
+        // the creator sizes the segment right after creating it
+        static std::size_t wait_for_size(int descriptor) {
+            struct stat status {};
+            while (true) {
+                if (::fstat(descriptor, &status) != 0) {
+                    throw std::system_error(errno, std::generic_category(), "fstat");
+                }
+                if (static_cast<std::size_t>(status.st_size) >= slots_offset) {
+                    return static_cast<std::size_t>(status.st_size);
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        void map(int descriptor) {
+            auto* address =
+                ::mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+            if (address == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "mmap");
+            }
+            header_ = static_cast<header*>(address);
+        }
+
+        std::string name_;
+        event_bus local_bus_;
+        std::size_t mapped_size_{0};
+        header* header_{nullptr};
+        slot* slots_{nullptr};
+        std::uint64_t capacity_{0};
+        std::uint64_t mask_{0};
+
+        mutable std::mutex poll_mutex_;
+        std::uint64_t next_{0};
+        std::uint64_t lost_{0};
+
+        std::mutex decoders_mutex_;
+        std::shared_ptr<const decoder_map> decoders_;
+    };
+}  // namespace dp
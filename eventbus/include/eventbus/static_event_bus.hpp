@@ -0,0 +1,291 @@
+#pragma once
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "detail/function_traits.hpp"
+#include "detail/inplace_handler.hpp"
+#include "event_bus.hpp"
+
+namespace dp {
+    namespace detail {
+        template <typename T, typename... Types>
+        struct type_list_index;
+
+        template <typename T, typename... Rest>
+        struct type_list_index<T, T, Rest...> : std::integral_constant<std::size_t, 0> {};
+
+        template <typename T, typename First, typename... Rest>
+        struct type_list_index<T, First, Rest...>
+            : std::integral_constant<std::size_t, 1 + type_list_index<T, Rest...>::value> {};
+
+        template <typename T, typename... Types>
+        inline constexpr bool type_list_contains_v = (std::is_same_v<T, Types> || ...);
+
+        // the event type a handler of a static_dispatcher is called for
+        template <typename Handler>
+        using static_handler_event_t =
+            std::decay_t<typename function_traits<Handler>::template arg<0>::type>;
+    }  // namespace detail
+
+    /**
+     * @brief An event bus for a set of event types that is known at compile time.
+     * @details Handler storage for every event type is a member of this class, so fire_event()
+     * resolves the handlers of an event type at compile time and is a plain loop over them. There
+     * is no type lookup, no locking and no type erasure of the event. The handlers themselves are
+     * registered at runtime and stored type erased, so every handler is still one indirect call
+     * that the compiler cannot inline, see static_dispatcher for handlers known at compile time.
+     * This class is not thread safe and handlers must not be registered or removed from inside a
+     * handler.
+     * @tparam Events The event types that can be fired on this bus.
+     */
+    template <typename... Events>
+    class static_event_bus {
+        static_assert(sizeof...(Events) > 0, "static_event_bus needs at least one event type.");
+
+        template <typename EventType>
+        using require_event = std::enable_if_t<
+            detail::type_list_contains_v<std::decay_t<EventType>, Events...>>;
+
+      public:
+        static_event_bus() = default;
+        static_event_bus(const static_event_bus&) = delete;
+        static_event_bus& operator=(const static_event_bus&) = delete;
+
+        /**
+         * @brief Register an event handler for a given event type.
+         * @tparam EventType The event type, must be one of Events.
+         * @tparam EventHandler The invocable event handler type.
+         * @param handler A callable handler of the event type. Can accept the event as param or
+         * take no params.
+         * @return A handler_registration instance for the given handler.
+         */
+        template <typename EventType, typename EventHandler, typename = require_event<EventType>,
+                  typename = std::enable_if_t<std::is_invocable_v<EventHandler> ||
+                                              std::is_invocable_v<EventHandler, const EventType&>>>
+        [[nodiscard]] handler_registration register_handler(EventHandler&& handler) {
+            using traits = detail::function_traits<EventHandler>;
+            if constexpr (traits::arity == 0) {
+                return add_handler<EventType>(
+                    [handler = std::forward<EventHandler>(handler)](const EventType&) mutable {
+                        handler();
+                    });
+            } else {
+                return add_handler<EventType>(std::forward<EventHandler>(handler));
+            }
+        }
+
+        /**
+         * @brief Register an event handler for a given event type.
+         * @tparam EventType The event type, must be one of Events.
+         * @tparam ClassType Event handler class
+         * @tparam MemberFunction Event handler member function
+         * @param class_instance Instance of ClassType that will handle the event.
+         * @param function Pointer to the MemberFunction of the ClassType.
+         * @return A handler_registration instance for the given handler.
+         */
+        template <typename EventType, typename ClassType, typename MemberFunction,
+                  typename = require_event<EventType>>
+        [[nodiscard]] handler_registration register_handler(ClassType* class_instance,
+                                                            MemberFunction&& function) {
+            using traits = detail::function_traits<MemberFunction>;
+            static_assert(std::is_same_v<ClassType, std::decay_t<typename traits::owner_type>>,
+                          "Member function pointer must match instance type.");
+
+            if constexpr (traits::arity == 0) {
+                return add_handler<EventType>([class_instance, function](const EventType&) {
+                    (class_instance->*function)();
+                });
+            } else {
+                return add_handler<EventType>([class_instance, function](const EventType& evt) {
+                    (class_instance->*function)(evt);
+                });
+            }
+        }
+
+        /**
+         * @brief Fire an event to notify event handlers.
+         * @tparam EventType The event type, must be one of Events.
+         * @param evt The event to pass to all event handlers.
+         */
+        template <typename EventType, typename = require_event<EventType>>
+        void fire_event(const EventType& evt) {
+            for (const auto& entry : handlers_of<EventType>()) {
+                entry.handler(evt);
+            }
+        }
+
+        /**
+         * @brief Remove a given handler from the event bus.
+         * @param registration The registration object returned by register_handler.
+         * @return true is handler removal was successful, false otherwise.
+         */
+        bool remove_handler(const handler_registration& registration) noexcept {
+            const auto& handle = registration.handle();
+            if (!handle.valid() || registration.event_bus_ != this ||
+                handle.slot >= slots_.size()) {
+                return false;
+            }
+            auto& slot = slots_[handle.slot];
+            if (slot.generation != handle.generation || slot.event_type != handle.event_type) {
+                return false;
+            }
+
+            remove_at(handle.event_type, slot.index, std::index_sequence_for<Events...>{});
+            release_slot(handle.slot);
+            --handler_count_;
+            return true;
+        }
+
+        /**
+         * @brief Remove all handlers from event bus.
+         */
+        void remove_handlers() noexcept {
+            std::apply([](auto&... handlers) { (handlers.clear(), ...); }, tables_);
+            for (std::uint32_t i = 0; i < slots_.size(); ++i) {
+                if (slots_[i].in_use) {
+                    release_slot(i);
+                }
+            }
+            handler_count_ = 0;
+        }
+
+        /**
+         * @brief Get the number of handlers registered with the event bus.
+         * @return The total number of handlers.
+         */
+        [[nodiscard]] std::size_t handler_count() const noexcept { return handler_count_; }
+
+      private:
+        template <typename EventType>
+        struct handler_entry {
+            std::uint32_t slot{0};
+            detail::inplace_handler<void(const EventType&)> handler;
+        };
+
+        struct registration_slot {
+            detail::type_id_t event_type{0};
+            std::uint32_t generation{1};
+            std::uint32_t index{0};
+            bool in_use{false};
+        };
+
+        std::tuple<std::vector<handler_entry<Events>>...> tables_;
+        std::vector<registration_slot> slots_;
+        std::vector<std::uint32_t> free_slots_;
+        std::size_t handler_count_{0};
+
+        template <typename EventType>
+        static constexpr std::size_t index_of =
+            detail::type_list_index<std::decay_t<EventType>, Events...>::value;
+
+        template <typename EventType>
+        auto& handlers_of() noexcept {
+            return std::get<index_of<EventType>>(tables_);
+        }
+
+        template <typename EventType, typename Handler>
+        handler_registration add_handler(Handler&& handler) {
+            auto& handlers = handlers_of<EventType>();
+            const auto slot_index = acquire_slot();
+            auto& slot = slots_[slot_index];
+            slot.event_type = index_of<EventType>;
+            slot.index = static_cast<std::uint32_t>(handlers.size());
+            handlers.push_back({slot_index, std::forward<Handler>(handler)});
+            ++handler_count_;
+            return {registration_handle{slot.event_type, slot_index, slot.generation}, this,
+                    [](void* bus, const handler_registration& registration) {
+                        return static_cast<static_event_bus*>(bus)->remove_handler(registration);
+                    }};
+        }
+
+        template <std::size_t... Indices>
+        void remove_at(std::size_t event_type, std::uint32_t index,
+                       std::index_sequence<Indices...>) noexcept {
+            // erase keeps the registration order, the slots of later handlers move down by one
+            const auto erase = [this, index](auto& handlers) {
+                handlers.erase(handlers.begin() + index);
+                for (auto i = index; i < handlers.size(); ++i) {
+                    slots_[handlers[i].slot].index = i;
+                }
+            };
+            ((event_type == Indices ? erase(std::get<Indices>(tables_)) : void()), ...);
+        }
+
+        std::uint32_t acquire_slot() {
+            std::uint32_t index;
+            if (free_slots_.empty()) {
+                index = static_cast<std::uint32_t>(slots_.size());
+                slots_.emplace_back();
+            } else {
+                index = free_slots_.back();
+                free_slots_.pop_back();
+            }
+            slots_[index].in_use = true;
+            return index;
+        }
+
+        void release_slot(std::uint32_t index) {
+            auto& slot = slots_[index];
+            slot.in_use = false;
+            // generation 0 is reserved for invalid handles
+            if (++slot.generation == 0) {
+                slot.generation = 1;
+            }
+            free_slots_.push_back(index);
+        }
+    };
+
+    /**
+     * @brief Calls a set of handlers that is known at compile time.
+     * @details The handlers are stored with their own types, so fire_event() calls the handlers
+     * of the event type directly and the compiler can inline them into the caller. Handlers take
+     * the event as their only parameter, which determines the event type they are called for.
+     * Handlers cannot be added or removed once the dispatcher is created. This class is not
+     * thread safe.
+     *
+     * `dp::static_dispatcher dispatcher{[](const first_event& evt) {}, on_second_event};`
+     * @tparam Handlers The handler types, usually deduced from the constructor arguments.
+     */
+    template <typename... Handlers>
+    class static_dispatcher {
+        static_assert(sizeof...(Handlers) > 0, "static_dispatcher needs at least one handler.");
+        static_assert(((detail::function_traits<Handlers>::arity == 1) && ...),
+                      "Handlers of a static_dispatcher must take the event as their only "
+                      "parameter.");
+
+        template <typename EventType>
+        using require_event = std::enable_if_t<detail::type_list_contains_v<
+            std::decay_t<EventType>, detail::static_handler_event_t<Handlers>...>>;
+
+      public:
+        explicit static_dispatcher(Handlers... handlers) : handlers_(std::move(handlers)...) {}
+
+        /**
+         * @brief Fire an event to call the handlers of its type in the order they were given.
+         * @tparam EventType The event type, at least one handler must take it.
+         * @param evt The event to pass to the handlers.
+         */
+        template <typename EventType, typename = require_event<EventType>>
+        void fire_event(const EventType& evt) {
+            std::apply([&evt](auto&... handlers) { (call_if_handled(handlers, evt), ...); },
+                       handlers_);
+        }
+
+      private:
+        std::tuple<Handlers...> handlers_;
+
+        template <typename Handler, typename EventType>
+        static void call_if_handled(Handler& handler, const EventType& evt) {
+            if constexpr (std::is_same_v<detail::static_handler_event_t<Handler>, EventType>) {
+                handler(evt);
+            }
+        }
+    };
+
+    template <typename... Handlers>
+    static_dispatcher(Handlers...) -> static_dispatcher<Handlers...>;
+}  // namespace dp
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "detail/inplace_handler.hpp"
+
+namespace dp {
+    namespace detail {
+        struct completion_state {
+            void complete() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done = true;
+                }
+                completed.notify_all();
+            }
+
+            std::mutex mutex;
+            std::condition_variable completed;
+            bool done{false};
+        };
+    }  // namespace detail
+
+    /**
+     * @brief Tells when work that was started asynchronously, such as
+     * event_bus::fire_event_async, has finished.
+     */
+    class completion_token {
+      public:
+        /**
+         * @brief A token of work that is already done.
+         */
+        completion_token() = default;
+
+        explicit completion_token(std::shared_ptr<detail::completion_state> state) noexcept
+            : state_(std::move(state)) {}
+
+        /**
+         * @brief Whether the work has finished, does not block.
+         */
+        [[nodiscard]] bool ready() const {
+            if (!state_) {
+                return true;
+            }
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            return state_->done;
+        }
+
+        /**
+         * @brief Block until the work has finished.
+         */
+        void wait() const {
+            if (state_) {
+                std::unique_lock<std::mutex> lock(state_->mutex);
+                state_->completed.wait(lock, [this]() { return state_->done; });
+            }
+        }
+
+        /**
+         * @brief Block until the work has finished or the timeout expired.
+         * @return true if the work has finished.
+         */
+        template <typename Rep, typename Period>
+        bool wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+            if (!state_) {
+                return true;
+            }
+            std::unique_lock<std::mutex> lock(state_->mutex);
+            return state_->completed.wait_for(lock, timeout, [this]() { return state_->done; });
+        }
+
+      private:
+        std::shared_ptr<detail::completion_state> state_;
+    };
+
+    /**
+     * @brief A fixed size thread pool where idle workers steal tasks from busy ones.
+     * @details Every worker has its own task queue. Tasks submitted by a worker go to the back of
+     * its own queue, which it works through last in first out, tasks submitted by other threads
+     * are spread over the queues. Workers that run out of tasks take the oldest task of another
+     * queue. Used by event_bus to call the handlers of an event in parallel.
+     */
+    class work_stealing_pool {
+      public:
+        using task = detail::inplace_handler<void()>;
+
+        /**
+         * @brief Start the workers.
+         * @param thread_count Number of worker threads, at least one worker is always started.
+         */
+        explicit work_stealing_pool(
+            std::size_t thread_count = std::thread::hardware_concurrency()) {
+            thread_count = std::max<std::size_t>(1, thread_count);
+            queues_.reserve(thread_count);
+            for (std::size_t i = 0; i < thread_count; ++i) {
+                queues_.push_back(std::make_unique<task_queue>());
+            }
+            threads_.reserve(thread_count);
+            for (std::size_t i = 0; i < thread_count; ++i) {
+                threads_.emplace_back([this, i]() { run(i); });
+            }
+        }
+
+        work_stealing_pool(const work_stealing_pool&) = delete;
+        work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+        /**
+         * @brief Run the tasks already submitted and join the workers.
+         */
+        ~work_stealing_pool() {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex_);
+                stopping_ = true;
+            }
+            wakeup_.notify_all();
+            for (auto& thread : threads_) {
+                thread.join();
+            }
+        }
+
+        /**
+         * @brief Queue a task. Must not be called once the pool is being destroyed.
+         */
+        void submit(task&& new_task) {
+            auto& target = *queues_[queue_for_submit()];
+            {
+                std::lock_guard<std::mutex> lock(target.mutex);
+                target.tasks.push_back(std::move(new_task));
+            }
+            {
+                // pairs with the check of sleeping workers, so the notification is not missed
+                std::lock_guard<std::mutex> lock(sleep_mutex_);
+                ++pending_;
+            }
+            wakeup_.notify_one();
+        }
+
+        /**
+         * @brief The number of worker threads.
+         */
+        [[nodiscard]] std::size_t thread_count() const noexcept { return threads_.size(); }
+
+      private:
+        // on its own cache lines so the queues of different workers do not false share
+        struct alignas(64) task_queue {
+            std::mutex mutex;
+            std::deque<task> tasks;
+        };
+
+        struct worker_identity {
+            const work_stealing_pool* pool{nullptr};
+            std::size_t index{0};
+        };
+
+        static worker_identity& current_worker() noexcept {
+            thread_local worker_identity identity;
+            return identity;
+        }
+
+        std::size_t queue_for_submit() noexcept {
+            const auto& identity = current_worker();
+            if (identity.pool == this) {
+                return identity.index;
+            }
+            return next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+        }
+
+        bool try_pop_own(std::size_t index, task& result) {
+            auto& own = *queues_[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.tasks.empty()) {
+                return false;
+            }
+            result = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+
+        bool try_steal(std::size_t thief, task& result) {
+            for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+                auto& victim = *queues_[(thief + offset) % queues_.size()];
+                std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+                if (!lock.owns_lock() || victim.tasks.empty()) {
+                    continue;
+                }
+                result = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+            return false;
+        }
+
+        void run(std::size_t index) {
+            current_worker() = {this, index};
+            task next_task;
+            while (true) {
+                if (try_pop_own(index, next_task) || try_steal(index, next_task)) {
+                    {
+                        std::lock_guard<std::mutex> lock(sleep_mutex_);
+                        --pending_;
+                    }
+                    next_task();
+                    next_task = nullptr;
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(sleep_mutex_);
+                if (pending_ == 0 && stopping_) {
+                    return;
+                }
+                // a task that is pending but was skipped by a failed try_lock is retried
+                wakeup_.wait_for(lock, std::chrono::milliseconds(1),
+                                 [this]() { return pending_ != 0 || stopping_; });
+            }
+        }
+
+        std::vector<std::unique_ptr<task_queue>> queues_;
+        std::vector<std::thread> threads_;
+        std::atomic<std::size_t> next_queue_{0};
+
+        std::mutex sleep_mutex_;
+        std::condition_variable wakeup_;
+        // submitted tasks that no worker took yet
+        std::size_t pending_{0};
+        bool stopping_{false};
+    };
+}  // namespace dp
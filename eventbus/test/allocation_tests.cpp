@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <eventbus/event_bus.hpp>
+#include <eventbus/handler_arena.hpp>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+    std::atomic<std::size_t> global_allocations{0};
+
+    void* counted_allocate(std::size_t size) {
+        ++global_allocations;
+        if (auto* ptr = std::malloc(size == 0 ? 1 : size)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+
+    void* counted_allocate(std::size_t size, std::align_val_t alignment) {
+        ++global_allocations;
+        const auto align = static_cast<std::size_t>(alignment);
+        // aligned_alloc requires the size to be a multiple of the alignment
+        if (auto* ptr = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+
+    class counting_resource : public std::pmr::memory_resource {
+      public:
+        std::size_t allocations{0};
+        std::size_t outstanding{0};
+
+      private:
+        // uses malloc directly so allocations made through it are not counted as global ones
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++allocations;
+            ++outstanding;
+            alignment = std::max(alignment, alignof(std::max_align_t));
+            if (auto* ptr = std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment *
+                                                              alignment)) {
+                return ptr;
+            }
+            throw std::bad_alloc();
+        }
+        void do_deallocate(void* ptr, std::size_t, std::size_t) override {
+            --outstanding;
+            std::free(ptr);
+        }
+        [[nodiscard]] bool do_is_equal(const memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    struct market_data_event {
+        std::string symbol;
+        double price{0.0};
+    };
+
+    class market_data_listener {
+        double total_{0.0};
+
+      public:
+        void on_market_data(const market_data_event& evt) { total_ += evt.price; }
+        [[nodiscard]] double total() const { return total_; }
+    };
+}  // namespace
+
+void* operator new(std::size_t size) { return counted_allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return counted_allocate(size, alignment);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return counted_allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return counted_allocate(size, alignment);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+TEST(Allocation, SteadyStateFireDoesNotAllocate) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        market_data_listener listener;
+        double lambda_total{0.0};
+        std::array<double, 32> large_capture{};
+        std::size_t batch_count{0};
+
+        std::vector<dp::handler_registration> registrations;
+        registrations.emplace_back(evt_bus.register_handler<market_data_event>(
+            &listener, &market_data_listener::on_market_data));
+        registrations.emplace_back(evt_bus.register_handler<market_data_event>(
+            [&lambda_total](const market_data_event& evt) { lambda_total += evt.price; }));
+        // stored on the heap, but only allocated once at registration
+        registrations.emplace_back(evt_bus.register_handler<market_data_event>(
+            [&lambda_total, large_capture]() { lambda_total += large_capture[0]; }));
+        registrations.emplace_back(evt_bus.register_batch_handler<market_data_event>(
+            [&batch_count](dp::event_batch<market_data_event> batch) {
+                batch_count += batch.size();
+            }));
+
+        const market_data_event evt{"a symbol that does not fit the small string buffer", 1.0};
+        const std::vector<market_data_event> batch(16, evt);
+        evt_bus.fire_event(evt);
+
+        const auto allocations_before = global_allocations.load();
+        for (auto i = 0; i < 1000; ++i) {
+            evt_bus.fire_event(evt);
+            evt_bus.fire_events(batch);
+        }
+        const auto allocations = global_allocations.load() - allocations_before;
+
+        EXPECT_EQ(allocations, 0);
+        EXPECT_DOUBLE_EQ(listener.total(), 17001.0);
+        EXPECT_EQ(batch_count, 17001);
+    }
+}
+
+TEST(Allocation, HandlerStorageUsesMemoryResource) {
+    counting_resource resource;
+    {
+        dp::event_bus evt_bus(dp::dispatch_mode::lock_free, &resource);
+        market_data_listener listener;
+        std::array<double, 32> large_capture{};
+
+        std::vector<dp::handler_registration> registrations;
+        registrations.reserve(100);
+        const auto allocations_before = global_allocations.load();
+        for (std::size_t i = 0; i < 50; ++i) {
+            registrations.emplace_back(evt_bus.register_handler<market_data_event>(
+                &listener, &market_data_listener::on_market_data));
+            registrations.emplace_back(
+                evt_bus.register_handler<market_data_event>([large_capture]() {}));
+        }
+        for (std::size_t i = 0; i < 100; i += 2) {
+            evt_bus.remove_handler(registrations[i]);
+        }
+        const auto allocations = global_allocations.load() - allocations_before;
+
+        EXPECT_EQ(allocations, 0);
+        EXPECT_GT(resource.allocations, 0);
+        EXPECT_EQ(evt_bus.handler_count(), 50);
+    }
+    EXPECT_EQ(resource.outstanding, 0);
+}
+
+TEST(Allocation, HandlerArena) {
+    dp::handler_arena<> arena;
+    dp::event_bus evt_bus(&arena);
+    market_data_listener listener;
+
+    const auto allocations_before = global_allocations.load();
+    auto registration = evt_bus.register_handler<market_data_event>(
+        &listener, &market_data_listener::on_market_data);
+    evt_bus.fire_event(market_data_event{"abc", 2.0});
+    EXPECT_TRUE(evt_bus.remove_handler(registration));
+    const auto allocations = global_allocations.load() - allocations_before;
+
+    EXPECT_EQ(allocations, 0);
+    EXPECT_DOUBLE_EQ(listener.total(), 2.0);
+}
@@ -0,0 +1,389 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <eventbus/async_event_bus.hpp>
+#include <eventbus/event_bus.hpp>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct sequence_event {
+        int producer{0};
+        int sequence{0};
+    };
+
+    struct message_event {
+        std::string message;
+    };
+
+    struct quote_event {
+        std::string symbol;
+        double price{0};
+        int updates{1};
+    };
+
+    struct blocking_event {};
+
+    // holds the single worker of an async_event_bus until it is released
+    struct worker_gate {
+        explicit worker_gate(dp::event_bus& evt_bus)
+            : registration(evt_bus.register_handler<blocking_event>([this]() {
+                  std::unique_lock<std::mutex> lock(mutex);
+                  entered = true;
+                  changed.notify_all();
+                  changed.wait(lock, [this] { return released; });
+              })) {}
+
+        // waits until the worker runs the handler, so it no longer holds the blocking event
+        void wait_until_blocked() {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return entered; });
+        }
+
+        void release() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                released = true;
+            }
+            changed.notify_all();
+        }
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool entered{false};
+        bool released{false};
+        dp::handler_registration registration;
+    };
+}  // namespace
+
+TEST(AsyncEventBus, PostAndFlush) {
+    dp::event_bus evt_bus;
+    std::atomic<int> sequence_count{0};
+    std::atomic<int> message_count{0};
+    auto sequence_reg =
+        evt_bus.register_handler<sequence_event>([&]() { ++sequence_count; });
+    auto message_reg = evt_bus.register_handler<message_event>(
+        [&](const message_event& evt) { EXPECT_EQ(evt.message, "hello"); ++message_count; });
+
+    dp::async_event_bus async_bus(evt_bus, 4);
+    EXPECT_EQ(async_bus.worker_count(), 4);
+    for (auto i = 0; i < 1000; ++i) {
+        EXPECT_EQ(async_bus.post_event(sequence_event{0, i}), dp::post_result::posted);
+        EXPECT_EQ(async_bus.post_event(message_event{"hello"}, dp::dispatch_order::unordered),
+                  dp::post_result::posted);
+    }
+    async_bus.flush();
+
+    EXPECT_EQ(sequence_count, 1000);
+    EXPECT_EQ(message_count, 1000);
+}
+
+TEST(AsyncEventBus, PerTypeOrderIsPreserved) {
+    constexpr auto producer_count = 4;
+    constexpr auto events_per_producer = 2000;
+
+    dp::event_bus evt_bus;
+    std::vector<int> last_sequence(static_cast<std::size_t>(producer_count), -1);
+    std::atomic<int> out_of_order{0};
+    auto registration = evt_bus.register_handler<sequence_event>(
+        [&](const sequence_event& evt) {
+            // per type ordering means a single worker runs this handler
+            auto& last = last_sequence[static_cast<std::size_t>(evt.producer)];
+            if (evt.sequence != last + 1) {
+                ++out_of_order;
+            }
+            last = evt.sequence;
+        });
+
+    dp::async_event_bus async_bus(evt_bus, 4);
+    std::vector<std::thread> producers;
+    for (auto p = 0; p < producer_count; ++p) {
+        producers.emplace_back([&async_bus, p]() {
+            for (auto i = 0; i < events_per_producer; ++i) {
+                async_bus.post_event(sequence_event{p, i});
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    async_bus.flush();
+
+    EXPECT_EQ(out_of_order, 0);
+    for (const auto sequence : last_sequence) {
+        EXPECT_EQ(sequence, events_per_producer - 1);
+    }
+}
+
+TEST(AsyncEventBus, ShutdownDrainsQueue) {
+    dp::event_bus evt_bus;
+    std::atomic<int> count{0};
+    auto registration = evt_bus.register_handler<sequence_event>([&]() {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        ++count;
+    });
+
+    {
+        dp::async_event_bus async_bus(evt_bus, 2);
+        for (auto i = 0; i < 200; ++i) {
+            async_bus.post_event(sequence_event{0, i}, dp::dispatch_order::unordered);
+        }
+        async_bus.shutdown();
+        EXPECT_EQ(count, 200);
+        EXPECT_EQ(async_bus.post_event(sequence_event{}), dp::post_result::stopped);
+    }
+    EXPECT_EQ(count, 200);
+}
+
+TEST(AsyncEventBus, ConflationKeepsLatestEvent) {
+    dp::event_bus evt_bus;
+    std::vector<double> prices;
+    auto registration = evt_bus.register_handler<quote_event>(
+        [&prices](const quote_event& evt) { prices.push_back(evt.price); });
+    worker_gate gate(evt_bus);
+
+    dp::async_event_bus async_bus(evt_bus, 1);
+    async_bus.conflate<quote_event>();
+    async_bus.post_event(blocking_event{});
+    for (auto i = 0; i < 100; ++i) {
+        EXPECT_EQ(async_bus.post_event(quote_event{"AAPL", static_cast<double>(i), 1}),
+                  dp::post_result::posted);
+    }
+    gate.release();
+    async_bus.flush();
+    EXPECT_EQ(prices, (std::vector<double>{99}));
+
+    // once dispatched, the next event is queued again
+    async_bus.post_event(quote_event{"AAPL", 100.0, 1});
+    async_bus.flush();
+    EXPECT_EQ(prices, (std::vector<double>{99, 100}));
+}
+
+TEST(AsyncEventBus, ConflationByKeyWithMerge) {
+    dp::event_bus evt_bus;
+    std::vector<quote_event> quotes;
+    auto registration = evt_bus.register_handler<quote_event>(
+        [&quotes](const quote_event& evt) { quotes.push_back(evt); });
+    worker_gate gate(evt_bus);
+
+    dp::async_event_bus async_bus(evt_bus, 1);
+    async_bus.conflate<quote_event>(&quote_event::symbol,
+                                    [](quote_event& queued, quote_event&& latest) {
+                                        queued.price = latest.price;
+                                        queued.updates += latest.updates;
+                                    });
+    // ignored, the type is already conflated
+    async_bus.conflate<quote_event>();
+
+    async_bus.post_event(blocking_event{});
+    for (auto i = 0; i < 10; ++i) {
+        async_bus.post_event(quote_event{"MSFT", 200.0 + i, 1});
+        async_bus.post_event(quote_event{"AAPL", 100.0 + i, 1});
+        // conflated types ignore the order argument
+        async_bus.post_event(quote_event{"GOOG", 300.0 + i, 1}, dp::dispatch_order::unordered);
+    }
+    gate.release();
+    async_bus.flush();
+
+    // one event per key, in the order the keys were first queued
+    ASSERT_EQ(quotes.size(), 3);
+    EXPECT_EQ(quotes[0].symbol, "MSFT");
+    EXPECT_EQ(quotes[1].symbol, "AAPL");
+    EXPECT_EQ(quotes[2].symbol, "GOOG");
+    EXPECT_EQ(quotes[0].price, 209);
+    EXPECT_EQ(quotes[1].price, 109);
+    EXPECT_EQ(quotes[2].price, 309);
+    for (const auto& quote : quotes) {
+        EXPECT_EQ(quote.updates, 10);
+    }
+}
+
+TEST(AsyncEventBus, ConflationFromManyProducers) {
+    constexpr auto producer_count = 4;
+    constexpr auto events_per_producer = 5000;
+
+    dp::event_bus evt_bus;
+    std::map<int, int> last_sequence;
+    std::atomic<int> out_of_order{0};
+    auto registration =
+        evt_bus.register_handler<sequence_event>([&](const sequence_event& evt) {
+            auto [last, inserted] = last_sequence.emplace(evt.producer, evt.sequence);
+            if (!inserted) {
+                if (evt.sequence <= last->second) {
+                    ++out_of_order;
+                }
+                last->second = evt.sequence;
+            }
+        });
+
+    dp::async_event_bus async_bus(evt_bus, 2);
+    async_bus.conflate<sequence_event>(&sequence_event::producer);
+    std::vector<std::thread> producers;
+    for (auto p = 0; p < producer_count; ++p) {
+        producers.emplace_back([&async_bus, p]() {
+            for (auto i = 0; i < events_per_producer; ++i) {
+                async_bus.post_event(sequence_event{p, i});
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    async_bus.flush();
+
+    // events may be skipped, but handlers never see an older event after a newer one
+    EXPECT_EQ(out_of_order, 0);
+    ASSERT_EQ(last_sequence.size(), producer_count);
+    for (const auto& [producer, sequence] : last_sequence) {
+        EXPECT_EQ(sequence, events_per_producer - 1);
+    }
+}
+
+TEST(AsyncEventBus, BoundedQueueOverflowPolicies) {
+    constexpr std::size_t capacity = 4;
+    for (const auto policy : {dp::overflow_policy::drop_newest, dp::overflow_policy::drop_oldest,
+                              dp::overflow_policy::fail}) {
+        dp::event_bus evt_bus;
+        std::vector<int> sequences;
+        auto registration = evt_bus.register_handler<sequence_event>(
+            [&sequences](const sequence_event& evt) { sequences.push_back(evt.sequence); });
+        worker_gate gate(evt_bus);
+
+        dp::async_event_bus async_bus(evt_bus, 1, dp::queue_options{capacity, policy});
+        async_bus.post_event(blocking_event{});
+        gate.wait_until_blocked();
+
+        std::vector<dp::post_result> results;
+        for (auto i = 0; i < 10; ++i) {
+            results.push_back(async_bus.post_event(sequence_event{0, i}));
+        }
+        const auto stats = async_bus.queue_stats();
+        ASSERT_EQ(stats.size(), 1);
+        EXPECT_EQ(stats[0].queued, capacity);
+        EXPECT_EQ(stats[0].high_water, capacity);
+        gate.release();
+        async_bus.flush();
+
+        const auto overflow_result = policy == dp::overflow_policy::drop_newest
+                                         ? dp::post_result::dropped
+                                         : dp::post_result::queue_full;
+        for (std::size_t i = 0; i < 10; ++i) {
+            const auto queued = i < 4 || policy == dp::overflow_policy::drop_oldest;
+            EXPECT_EQ(results[i], queued ? dp::post_result::posted : overflow_result);
+        }
+        const auto final_stats = async_bus.queue_stats()[0];
+        EXPECT_EQ(final_stats.queued, 0);
+        if (policy == dp::overflow_policy::drop_oldest) {
+            // the newest events survive
+            EXPECT_EQ(sequences, (std::vector<int>{6, 7, 8, 9}));
+            EXPECT_EQ(final_stats.posted, 11);
+            EXPECT_EQ(final_stats.dropped, 6);
+            EXPECT_EQ(final_stats.rejected, 0);
+        } else {
+            EXPECT_EQ(sequences, (std::vector<int>{0, 1, 2, 3}));
+            EXPECT_EQ(final_stats.posted, 5);
+            EXPECT_EQ(final_stats.dropped, policy == dp::overflow_policy::drop_newest ? 6 : 0);
+            EXPECT_EQ(final_stats.rejected, policy == dp::overflow_policy::fail ? 6 : 0);
+        }
+    }
+}
+
+TEST(AsyncEventBus, BoundedQueueBlocksProducers) {
+    constexpr auto producer_count = 4;
+    constexpr auto events_per_producer = 2000;
+    constexpr std::size_t capacity = 16;
+
+    dp::event_bus evt_bus;
+    std::vector<int> last_sequence(static_cast<std::size_t>(producer_count), -1);
+    std::atomic<int> out_of_order{0};
+    auto registration = evt_bus.register_handler<sequence_event>(
+        [&](const sequence_event& evt) {
+            auto& last = last_sequence[static_cast<std::size_t>(evt.producer)];
+            if (evt.sequence != last + 1) {
+                ++out_of_order;
+            }
+            last = evt.sequence;
+        });
+
+    dp::async_event_bus async_bus(evt_bus, 2,
+                                  dp::queue_options{capacity, dp::overflow_policy::block});
+    std::atomic<int> not_posted{0};
+    std::vector<std::thread> producers;
+    for (auto p = 0; p < producer_count; ++p) {
+        producers.emplace_back([&, p]() {
+            for (auto i = 0; i < events_per_producer; ++i) {
+                if (async_bus.post_event(sequence_event{p, i}) != dp::post_result::posted) {
+                    ++not_posted;
+                }
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    async_bus.flush();
+
+    // nothing is lost and the queues never grow beyond their capacity
+    EXPECT_EQ(not_posted, 0);
+    EXPECT_EQ(out_of_order, 0);
+    for (const auto sequence : last_sequence) {
+        EXPECT_EQ(sequence, events_per_producer - 1);
+    }
+    for (const auto& stats : async_bus.queue_stats()) {
+        EXPECT_LE(stats.high_water, capacity);
+        EXPECT_EQ(stats.dropped, 0);
+    }
+}
+
+TEST(AsyncEventBus, BlockedProducerReturnsOnShutdown) {
+    dp::event_bus evt_bus;
+    worker_gate gate(evt_bus);
+    dp::async_event_bus async_bus(evt_bus, 1,
+                                  dp::queue_options{1, dp::overflow_policy::block});
+    async_bus.post_event(blocking_event{});
+    gate.wait_until_blocked();
+    EXPECT_EQ(async_bus.post_event(sequence_event{}), dp::post_result::posted);
+
+    // the queue stays full while the worker is blocked
+    auto producer = std::thread([&async_bus]() {
+        EXPECT_EQ(async_bus.post_event(sequence_event{}), dp::post_result::stopped);
+    });
+    auto stopper = std::thread([&async_bus]() { async_bus.shutdown(); });
+    producer.join();
+    gate.release();
+    stopper.join();
+}
+
+TEST(AsyncEventBus, ConflationWithDropOldest) {
+    dp::event_bus evt_bus;
+    std::vector<quote_event> quotes;
+    auto registration = evt_bus.register_handler<quote_event>(
+        [&quotes](const quote_event& evt) { quotes.push_back(evt); });
+    worker_gate gate(evt_bus);
+
+    dp::async_event_bus async_bus(evt_bus, 1,
+                                  dp::queue_options{2, dp::overflow_policy::drop_oldest});
+    async_bus.conflate<quote_event>(&quote_event::symbol);
+    async_bus.post_event(blocking_event{});
+    gate.wait_until_blocked();
+
+    async_bus.post_event(quote_event{"AAPL", 1.0, 1});
+    async_bus.post_event(quote_event{"MSFT", 2.0, 1});
+    // drops AAPL, the next AAPL event is queued again and drops MSFT
+    async_bus.post_event(quote_event{"GOOG", 3.0, 1});
+    async_bus.post_event(quote_event{"GOOG", 4.0, 1});
+    async_bus.post_event(quote_event{"AAPL", 5.0, 1});
+    gate.release();
+    async_bus.flush();
+
+    ASSERT_EQ(quotes.size(), 2);
+    EXPECT_EQ(quotes[0].symbol, "GOOG");
+    EXPECT_EQ(quotes[0].price, 4);
+    EXPECT_EQ(quotes[1].symbol, "AAPL");
+    EXPECT_EQ(quotes[1].price, 5);
+    EXPECT_EQ(async_bus.queue_stats()[0].dropped, 2);
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <eventbus/buffered_publisher.hpp>
+#include <eventbus/event_bus.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct sequence_event {
+        int producer{0};
+        int sequence{0};
+    };
+
+    struct message_event {
+        std::string message;
+    };
+}  // namespace
+
+TEST(BufferedPublisher, FlushDispatchesInPublishOrder) {
+    dp::event_bus evt_bus;
+    std::vector<std::string> seen;
+    std::vector<std::size_t> batch_sizes;
+    auto sequence_reg = evt_bus.register_handler<sequence_event>(
+        [&seen](const sequence_event& evt) { seen.push_back(std::to_string(evt.sequence)); });
+    auto message_reg = evt_bus.register_handler<message_event>(
+        [&seen](const message_event& evt) { seen.push_back(evt.message); });
+    auto batch_reg = evt_bus.register_batch_handler<sequence_event>(
+        [&batch_sizes](dp::event_batch<sequence_event> batch) {
+            batch_sizes.push_back(batch.size());
+        });
+
+    dp::buffered_publisher publisher(evt_bus, dp::publish_options{100, {}});
+    publisher.publish(sequence_event{0, 1});
+    const sequence_event second{0, 2};
+    publisher.publish(second);
+    publisher.publish(message_event{"a"});
+    publisher.publish(sequence_event{0, 3});
+    EXPECT_TRUE(seen.empty());
+    EXPECT_EQ(publisher.pending(), 4);
+
+    publisher.flush();
+    EXPECT_EQ(seen, (std::vector<std::string>{"1", "2", "a", "3"}));
+    // consecutive events of a type are dispatched as one batch
+    EXPECT_EQ(batch_sizes, (std::vector<std::size_t>{2, 1}));
+    EXPECT_EQ(publisher.pending(), 0);
+
+    publisher.flush();
+    EXPECT_EQ(seen.size(), 4);
+}
+
+TEST(BufferedPublisher, FlushesAtBatchSize) {
+    dp::event_bus evt_bus;
+    int count{0};
+    auto registration = evt_bus.register_handler<sequence_event>([&count]() { ++count; });
+
+    dp::buffered_publisher publisher(evt_bus, dp::publish_options{3, {}});
+    publisher.publish(sequence_event{});
+    publisher.publish(sequence_event{});
+    EXPECT_EQ(count, 0);
+    publisher.publish(sequence_event{});
+    EXPECT_EQ(count, 3);
+    publisher.publish(sequence_event{});
+    EXPECT_EQ(count, 3);
+    EXPECT_EQ(publisher.pending(), 1);
+}
+
+TEST(BufferedPublisher, FlushesAfterMaxDelay) {
+    dp::event_bus evt_bus;
+    std::atomic<int> count{0};
+    auto registration = evt_bus.register_handler<sequence_event>([&count]() { ++count; });
+
+    dp::buffered_publisher publisher(
+        evt_bus, dp::publish_options{1000, std::chrono::microseconds(200)});
+    publisher.publish(sequence_event{});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (count == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(count, 1);
+}
+
+TEST(BufferedPublisher, DestructorFlushes) {
+    dp::event_bus evt_bus;
+    int count{0};
+    auto registration = evt_bus.register_handler<sequence_event>([&count]() { ++count; });
+    {
+        dp::buffered_publisher publisher(evt_bus, dp::publish_options{100, {}});
+        publisher.publish(sequence_event{});
+    }
+    EXPECT_EQ(count, 1);
+}
+
+TEST(BufferedPublisher, ManyShortLivedPublishersOnOneThread) {
+    dp::event_bus evt_bus;
+    int count{0};
+    auto registration = evt_bus.register_handler<sequence_event>([&count]() { ++count; });
+    dp::buffered_publisher long_lived(evt_bus, dp::publish_options{2000, {}});
+    for (auto i = 0; i < 1000; ++i) {
+        // the thread drops the buffers of destroyed publishers it used
+        dp::buffered_publisher publisher(evt_bus, dp::publish_options{100, {}});
+        publisher.publish(sequence_event{0, i});
+        long_lived.publish(sequence_event{1, i});
+    }
+    EXPECT_EQ(count, 1000);
+    EXPECT_EQ(long_lived.pending(), 1000);
+    long_lived.flush();
+    EXPECT_EQ(count, 2000);
+}
+
+TEST(BufferedPublisher, PublishFromHandler) {
+    dp::event_bus evt_bus;
+    dp::buffered_publisher publisher(evt_bus, dp::publish_options{1, {}});
+    std::vector<std::string> seen;
+    auto sequence_reg = evt_bus.register_handler<sequence_event>(
+        [&](const sequence_event& evt) {
+            seen.push_back(std::to_string(evt.sequence));
+            publisher.publish(message_event{"from handler"});
+        });
+    auto message_reg = evt_bus.register_handler<message_event>(
+        [&seen](const message_event& evt) { seen.push_back(evt.message); });
+
+    // the event published by the handler waits for the next flush instead of recursing
+    publisher.publish(sequence_event{0, 1});
+    EXPECT_EQ(seen, (std::vector<std::string>{"1"}));
+    publisher.flush();
+    EXPECT_EQ(seen, (std::vector<std::string>{"1", "from handler"}));
+}
+
+TEST(BufferedPublisher, PerProducerOrderFromManyThreads) {
+    constexpr auto producer_count = 4;
+    constexpr auto events_per_producer = 5000;
+
+    dp::event_bus evt_bus;
+    std::vector<int> last_sequence(static_cast<std::size_t>(producer_count), -1);
+    std::atomic<int> out_of_order{0};
+    std::mutex handler_mutex;
+    auto registration = evt_bus.register_handler<sequence_event>([&](const sequence_event& evt) {
+        std::lock_guard<std::mutex> lock(handler_mutex);
+        auto& last = last_sequence[static_cast<std::size_t>(evt.producer)];
+        if (evt.sequence != last + 1) {
+            ++out_of_order;
+        }
+        last = evt.sequence;
+    });
+
+    dp::buffered_publisher publisher(evt_bus,
+                                     dp::publish_options{64, std::chrono::microseconds(100)});
+    std::vector<std::thread> producers;
+    for (auto p = 0; p < producer_count; ++p) {
+        producers.emplace_back([&publisher, p]() {
+            for (auto i = 0; i < events_per_producer; ++i) {
+                publisher.publish(sequence_event{p, i});
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    publisher.flush();
+
+    EXPECT_EQ(out_of_order, 0);
+    for (const auto sequence : last_sequence) {
+        EXPECT_EQ(sequence, events_per_producer - 1);
+    }
+}
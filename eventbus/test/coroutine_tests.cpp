@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <coroutine>
+#include <eventbus/event_bus.hpp>
+#include <eventbus/sharded_event_bus.hpp>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+static_assert(EVENTBUS_HAS_COROUTINES, "This test must be built with C++20 coroutines.");
+
+namespace {
+    struct response_event {
+        int request_id{0};
+        std::string body;
+    };
+
+    struct shutdown_event {};
+
+    /**
+     * Minimal eagerly started coroutine that keeps its frame until it is destroyed.
+     */
+    class task {
+      public:
+        struct promise_type {
+            task get_return_object() {
+                return task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        task(task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+        task& operator=(task&&) = delete;
+        ~task() {
+            if (handle_) {
+                handle_.destroy();
+            }
+        }
+
+        [[nodiscard]] bool done() const { return handle_.done(); }
+
+      private:
+        explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    template <typename Bus>
+    task wait_for_response(Bus& evt_bus, int request_id, std::vector<std::string>& bodies) {
+        const auto response = co_await evt_bus.template next<response_event>(
+            [request_id](const response_event& evt) { return evt.request_id == request_id; });
+        bodies.push_back(response.body);
+    }
+}  // namespace
+
+TEST(Coroutines, ResumesOnMatchingEvent) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        std::vector<std::string> bodies;
+        auto waiting = wait_for_response(evt_bus, 2, bodies);
+        EXPECT_FALSE(waiting.done());
+        EXPECT_EQ(evt_bus.handler_count(), 1);
+
+        evt_bus.fire_event(response_event{1, "first"});
+        EXPECT_FALSE(waiting.done());
+        evt_bus.fire_event(response_event{2, "second"});
+        EXPECT_TRUE(waiting.done());
+        EXPECT_EQ(bodies, (std::vector<std::string>{"second"}));
+        // the wait removed its handler
+        EXPECT_EQ(evt_bus.handler_count(), 0);
+
+        evt_bus.fire_event(response_event{2, "third"});
+        EXPECT_EQ(bodies.size(), 1);
+    }
+}
+
+TEST(Coroutines, ManyConcurrentWaits) {
+    dp::event_bus evt_bus;
+    std::vector<std::string> bodies;
+    std::vector<task> tasks;
+    for (int i = 0; i < 1000; ++i) {
+        tasks.push_back(wait_for_response(evt_bus, i, bodies));
+    }
+    EXPECT_EQ(evt_bus.handler_count(), 1000);
+
+    for (int i = 999; i >= 0; --i) {
+        evt_bus.fire_event(response_event{i, std::to_string(i)});
+    }
+    for (const auto& waiting : tasks) {
+        EXPECT_TRUE(waiting.done());
+    }
+    ASSERT_EQ(bodies.size(), 1000);
+    EXPECT_EQ(bodies.front(), "999");
+    EXPECT_EQ(bodies.back(), "0");
+    EXPECT_EQ(evt_bus.handler_count(), 0);
+}
+
+TEST(Coroutines, SequentialWaits) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        std::vector<int> seen;
+        // waits again from inside the handler that resumed it
+        auto waiting = [](dp::event_bus& bus, std::vector<int>& ids) -> task {
+            while (true) {
+                const auto response = co_await bus.next<response_event>();
+                ids.push_back(response.request_id);
+                if (response.request_id < 0) {
+                    co_return;
+                }
+            }
+        }(evt_bus, seen);
+
+        evt_bus.fire_event(response_event{1, "loop"});
+        evt_bus.fire_event(response_event{2, "loop"});
+        evt_bus.fire_event(response_event{-1, "loop"});
+        EXPECT_TRUE(waiting.done());
+        EXPECT_EQ(seen, (std::vector<int>{1, 2, -1}));
+        EXPECT_EQ(evt_bus.handler_count(), 0);
+    }
+}
+
+TEST(Coroutines, DestroyingTheCoroutineCancelsTheWait) {
+    dp::event_bus evt_bus;
+    std::vector<std::string> bodies;
+    {
+        auto waiting = wait_for_response(evt_bus, 1, bodies);
+        EXPECT_EQ(evt_bus.handler_count(), 1);
+    }
+    EXPECT_EQ(evt_bus.handler_count(), 0);
+    evt_bus.fire_event(response_event{1, "late"});
+    EXPECT_TRUE(bodies.empty());
+}
+
+TEST(Coroutines, CustomExecutor) {
+    dp::event_bus evt_bus;
+    std::vector<std::coroutine_handle<>> ready;
+    auto waiting = [](dp::event_bus& bus,
+                      std::vector<std::coroutine_handle<>>& queue) -> task {
+        co_await bus.next<shutdown_event>(
+            dp::detail::any_event{}, [&queue](std::coroutine_handle<> handle) {
+                queue.push_back(handle);
+            });
+    }(evt_bus, ready);
+
+    evt_bus.fire_event(shutdown_event{});
+    // queued instead of resumed inside fire_event
+    EXPECT_FALSE(waiting.done());
+    ASSERT_EQ(ready.size(), 1);
+    ready.front().resume();
+    EXPECT_TRUE(waiting.done());
+    EXPECT_EQ(evt_bus.handler_count(), 0);
+}
+
+TEST(Coroutines, ShardedEventBus) {
+    dp::sharded_event_bus evt_bus(4);
+    std::vector<std::string> bodies;
+    auto waiting = wait_for_response(evt_bus, 7, bodies);
+    evt_bus.fire_event(response_event{7, "sharded"});
+    EXPECT_TRUE(waiting.done());
+    EXPECT_EQ(bodies, (std::vector<std::string>{"sharded"}));
+    EXPECT_EQ(evt_bus.handler_count(), 0);
+}
@@ -1,8 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <array>
 #include <atomic>
 #include <eventbus/event_bus.hpp>
+#include <functional>
+#include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 
 struct test_event_type {
     int id{-1};
@@ -74,46 +79,155 @@ TEST(EventBus, LambdaRegistrationAndDeregistration) {
 }
 
 TEST(EventBus, DeregisterWhileDispatching) {
-    dp::event_bus evt_bus;
-    event_handler_counter counter;
-    auto registration =
-        evt_bus.register_handler<test_event_type>(&counter, &event_handler_counter::on_test_event);
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        event_handler_counter counter;
+        auto registration = evt_bus.register_handler<test_event_type>(
+            &counter, &event_handler_counter::on_test_event);
 
-    struct deregister_while_dispatch_listener {
-        dp::event_bus* evt_bus{nullptr};
-        std::vector<dp::handler_registration>* registrations{nullptr};
-        void on_event(test_event_type) {
-            if (evt_bus && registrations) {
-                std::for_each(registrations->begin(), registrations->end(),
-                              [&](auto& reg) { evt_bus->remove_handler(reg); });
+        struct deregister_while_dispatch_listener {
+            dp::event_bus* evt_bus{nullptr};
+            std::vector<dp::handler_registration>* registrations{nullptr};
+            int calls{0};
+            void on_event(test_event_type) {
+                ++calls;
+                if (evt_bus && registrations) {
+                    for (auto& reg : *registrations) {
+                        EXPECT_TRUE(evt_bus->remove_handler(reg));
+                    }
+                }
             }
+        };
+
+        std::vector<dp::handler_registration> registrations;
+        // the handlers point into the vector, so it must not reallocate
+        std::vector<deregister_while_dispatch_listener> listeners(20);
+        for (auto& listener : listeners) {
+            registrations.emplace_back(evt_bus.register_handler<test_event_type>(
+                &listener, &deregister_while_dispatch_listener::on_event));
         }
-    };
+        EXPECT_EQ(evt_bus.handler_count(), listeners.size() + 1);
 
-    std::vector<dp::handler_registration> registrations;
-    std::vector<deregister_while_dispatch_listener> listeners;
-    for (auto i = 0; i < 20; ++i) {
-        deregister_while_dispatch_listener listener;
-        auto reg = evt_bus.register_handler<test_event_type>(
-            &listener, &deregister_while_dispatch_listener::on_event);
-        listeners.emplace_back(listener);
-        registrations.emplace_back(std::move(reg));
-    }
+        listeners[0].evt_bus = &evt_bus;
+        listeners[0].registrations = &registrations;
 
-    listeners[0].evt_bus = &evt_bus;
-    listeners[0].registrations = &registrations;
+        // the first listener removes all listeners, including itself, from inside the dispatch
+        for (auto i = 0; i < 3; ++i) {
+            evt_bus.fire_event(test_event_type{3, "test event", 3.4});
+            EXPECT_EQ(evt_bus.handler_count(), 1);
+        }
+        EXPECT_EQ(counter.get_count(), 3);
+        EXPECT_EQ(listeners[0].calls, 1);
+        if (mode == dp::dispatch_mode::locked) {
+            // removed before they were called. A lock free dispatch may still call handlers
+            // that were removed after it started.
+            for (std::size_t i = 1; i < listeners.size(); ++i) {
+                EXPECT_EQ(listeners[i].calls, 0);
+            }
+        }
 
-    for (auto i = 0; i < 40; ++i) {
-        evt_bus.fire_event(test_event_type{3, "test event", 3.4});
-        // add 1 because of the test fixture.
-        EXPECT_EQ(evt_bus.handler_count(), listeners.size() + 1);
+        for (auto& reg : registrations) {
+            EXPECT_FALSE(evt_bus.remove_handler(reg));
+        }
+        EXPECT_EQ(evt_bus.handler_count(), 1);
     }
+}
 
-    // remove all the registrations
-    for (auto& reg : registrations) {
-        EXPECT_TRUE(evt_bus.remove_handler(reg));
+TEST(EventBus, RegisterWhileDispatching) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        std::vector<int> calls;
+        std::vector<dp::handler_registration> registrations;
+
+        // a self renewing subscription replaces itself on every event
+        std::function<void(const test_event_type&)> renewing;
+        renewing = [&](const test_event_type& evt) {
+            calls.push_back(evt.id);
+            EXPECT_EQ(evt_bus.handler_count(), 1);
+            registrations.back().unregister();
+            registrations.push_back(evt_bus.register_handler<test_event_type>(renewing));
+        };
+        registrations.push_back(evt_bus.register_handler<test_event_type>(renewing));
+
+        // handlers registered during a dispatch are not called for the event being dispatched
+        evt_bus.fire_event(test_event_type{1, "dispatch", 1.0});
+        EXPECT_EQ(calls, (std::vector<int>{1}));
+        EXPECT_EQ(evt_bus.handler_count(), 1);
+        evt_bus.fire_event(test_event_type{2, "dispatch", 1.0});
+        EXPECT_EQ(calls, (std::vector<int>{1, 2}));
+        EXPECT_EQ(evt_bus.handler_count(), 1);
+
+        evt_bus.remove_handlers();
+        registrations.clear();
+        calls.clear();
+
+        // a one shot subscription, and a handler that is removed before it was ever added
+        auto one_shot = std::make_unique<dp::handler_registration>(
+            evt_bus.register_handler<test_event_type>([&calls]() { calls.push_back(0); }));
+        auto outer = evt_bus.register_handler<test_event_type>(
+            [&](const test_event_type& evt) {
+                if (evt.id != 1) {
+                    return;
+                }
+                one_shot->unregister();
+                auto short_lived =
+                    evt_bus.register_handler<test_event_type>([&calls]() { calls.push_back(-1); });
+                EXPECT_TRUE(evt_bus.remove_handler(short_lived));
+                EXPECT_FALSE(evt_bus.remove_handler(short_lived));
+                // fired again from inside the handler
+                evt_bus.fire_event(test_event_type{2, "dispatch", 1.0});
+            },
+            1);
+        evt_bus.fire_event(test_event_type{1, "dispatch", 1.0});
+        evt_bus.fire_event(test_event_type{3, "dispatch", 1.0});
+        EXPECT_TRUE(calls.empty());
+        EXPECT_EQ(evt_bus.handler_count(), 1);
+
+        // remove_handlers() from inside a handler
+        auto clearing = evt_bus.register_handler<test_event_type>(
+            [&evt_bus]() { evt_bus.remove_handlers(); });
+        evt_bus.fire_event(test_event_type{4, "dispatch", 1.0});
+        EXPECT_EQ(evt_bus.handler_count(), 0);
+
+        // registrations around remove_handlers() from inside a handler apply in call order
+        auto replacing = evt_bus.register_handler<test_event_type>(
+            [&](const test_event_type& evt) {
+                if (evt.id != 5) {
+                    return;
+                }
+                registrations.push_back(
+                    evt_bus.register_handler<test_event_type>([&calls]() { calls.push_back(-1); }));
+                evt_bus.remove_handlers();
+                registrations.push_back(evt_bus.register_handler<test_event_type>(
+                    [&calls](const test_event_type& received) { calls.push_back(received.id); }));
+            });
+        evt_bus.fire_event(test_event_type{5, "dispatch", 1.0});
+        EXPECT_EQ(evt_bus.handler_count(), 1);
+        evt_bus.fire_event(test_event_type{6, "dispatch", 1.0});
+        EXPECT_EQ(calls, (std::vector<int>{6}));
     }
+}
 
+TEST(EventBus, RegisterWhileDispatchingFromManyThreads) {
+    dp::event_bus evt_bus;
+    std::atomic<int> inner_calls{0};
+    auto outer = evt_bus.register_handler<test_event_type>([&]() {
+        // registered and removed again by the same handler call
+        auto inner = evt_bus.register_handler<test_event_type>([&inner_calls]() { ++inner_calls; });
+    });
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&evt_bus]() {
+            for (int j = 0; j < 1000; ++j) {
+                evt_bus.fire_event(test_event_type{});
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(inner_calls.load(), 0);
     EXPECT_EQ(evt_bus.handler_count(), 1);
 }
 
@@ -163,6 +277,77 @@ TEST(EventBus, MultiThreaded) {
     EXPECT_EQ(event_counter.get_count(), 10);
 }
 
+TEST(EventBus, MultiThreadedScaling) {
+    constexpr auto events_per_thread = 2000;
+
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        for (auto thread_count = 1; thread_count <= 64; thread_count *= 2) {
+            dp::event_bus evt_bus(mode);
+            event_handler_counter event_counter;
+            auto event_handler_reg = evt_bus.register_handler<test_event_type>(
+                &event_counter, &event_handler_counter::on_test_event);
+
+            // churn registrations while the other threads are firing
+            std::atomic<bool> done{false};
+            auto churn_thread = std::thread([&evt_bus, &done]() {
+                std::vector<dp::handler_registration> registrations;
+                while (!done) {
+                    registrations.emplace_back(
+                        evt_bus.register_handler<test_event_type>([](const test_event_type&) {}));
+                    if (registrations.size() > 16) {
+                        registrations.clear();
+                    }
+                }
+            });
+
+            std::vector<std::thread> threads;
+            for (auto i = 0; i < thread_count; ++i) {
+                threads.emplace_back([&evt_bus]() {
+                    const test_event_type evt{3, "scaling", 1.0};
+                    for (auto j = 0; j < events_per_thread; ++j) {
+                        evt_bus.fire_event(evt);
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            done = true;
+            churn_thread.join();
+
+            EXPECT_EQ(event_counter.get_count(),
+                      static_cast<unsigned int>(thread_count * events_per_thread));
+        }
+    }
+}
+
+TEST(EventBus, LockFreeRegistrationAndDeregistration) {
+    dp::event_bus evt_bus(dp::dispatch_mode::lock_free);
+    EXPECT_EQ(evt_bus.mode(), dp::dispatch_mode::lock_free);
+
+    event_handler_counter counter;
+    auto registration =
+        evt_bus.register_handler<test_event_type>(&counter, &event_handler_counter::on_test_event);
+    std::vector<dp::handler_registration> registrations;
+    for (auto i = 0; i < 100; ++i) {
+        registrations.emplace_back(evt_bus.register_handler<test_event_type>(
+            &counter, &event_handler_counter::on_test_event));
+    }
+
+    evt_bus.fire_event(test_event_type{});
+    EXPECT_EQ(counter.get_count(), 101);
+
+    registrations.clear();
+    EXPECT_EQ(evt_bus.handler_count(), 1);
+    evt_bus.fire_event(test_event_type{});
+    EXPECT_EQ(counter.get_count(), 102);
+
+    evt_bus.remove_handlers();
+    evt_bus.fire_event(test_event_type{});
+    EXPECT_EQ(counter.get_count(), 102);
+    EXPECT_FALSE(evt_bus.remove_handler(registration));
+}
+
 TEST(EventBus, AutoDeregisterInDtor) {
     dp::event_bus evt_bus;
     event_handler_counter counter;
@@ -176,4 +361,622 @@ TEST(EventBus, AutoDeregisterInDtor) {
     evt_bus.fire_event(test_event_type{});
     evt_bus.fire_event(test_event_type{});
     EXPECT_EQ(counter.get_count(), 0);
-}
\ No newline at end of file
+}
+
+TEST(EventBus, FireEventDoesNotCopyEvent) {
+    struct copy_counting_event {
+        std::atomic<int>* copies{nullptr};
+        copy_counting_event() = default;
+        explicit copy_counting_event(std::atomic<int>* counter) : copies(counter) {}
+        copy_counting_event(const copy_counting_event& other) : copies(other.copies) {
+            ++(*copies);
+        }
+        copy_counting_event& operator=(const copy_counting_event& other) {
+            copies = other.copies;
+            ++(*copies);
+            return *this;
+        }
+    };
+
+    dp::event_bus evt_bus;
+    std::atomic<int> copy_count{0};
+    std::atomic<int> call_count{0};
+
+    std::vector<dp::handler_registration> registrations;
+    for (auto i = 0; i < 5; ++i) {
+        registrations.emplace_back(evt_bus.register_handler<copy_counting_event>(
+            [&call_count](const copy_counting_event&) { ++call_count; }));
+    }
+
+    copy_counting_event evt{&copy_count};
+    evt_bus.fire_event(evt);
+    evt_bus.fire_event(copy_counting_event{&copy_count});
+    EXPECT_EQ(call_count, 10);
+    EXPECT_EQ(copy_count, 0);
+
+    // handlers that take the event by value get their own copy
+    registrations.emplace_back(evt_bus.register_handler<copy_counting_event>(
+        [&call_count](copy_counting_event) { ++call_count; }));
+    evt_bus.fire_event(evt);
+    EXPECT_EQ(call_count, 16);
+    EXPECT_EQ(copy_count, 1);
+}
+
+TEST(EventBus, HandlersAreIsolatedPerEventType) {
+    struct other_event_type {
+        int value{0};
+    };
+
+    dp::event_bus evt_bus;
+    int test_event_calls{0};
+    int other_event_calls{0};
+    auto test_reg = evt_bus.register_handler<test_event_type>([&]() { ++test_event_calls; });
+    auto other_reg = evt_bus.register_handler<other_event_type>(
+        [&](const other_event_type& evt) { other_event_calls += evt.value; });
+
+    EXPECT_NE(test_reg.handle().event_type, other_reg.handle().event_type);
+
+    const test_event_type test_event{};
+    evt_bus.fire_event(test_event);
+    evt_bus.fire_event(other_event_type{2});
+    EXPECT_EQ(test_event_calls, 1);
+    EXPECT_EQ(other_event_calls, 2);
+
+    EXPECT_TRUE(evt_bus.remove_handler(test_reg));
+    EXPECT_FALSE(evt_bus.remove_handler(test_reg));
+    evt_bus.fire_event(test_event_type{});
+    evt_bus.fire_event(other_event_type{2});
+    EXPECT_EQ(test_event_calls, 1);
+    EXPECT_EQ(other_event_calls, 4);
+    EXPECT_EQ(evt_bus.handler_count(), 1);
+}
+
+TEST(EventBus, StaleRegistrationDoesNotRemoveReusedSlot) {
+    dp::event_bus evt_bus;
+    int first_calls{0};
+    int second_calls{0};
+
+    auto first_reg = evt_bus.register_handler<test_event_type>([&]() { ++first_calls; });
+    EXPECT_TRUE(evt_bus.remove_handler(first_reg));
+
+    // the freed slot is reused with a new generation
+    auto second_reg = evt_bus.register_handler<test_event_type>([&]() { ++second_calls; });
+    EXPECT_EQ(first_reg.handle().slot, second_reg.handle().slot);
+    EXPECT_NE(first_reg.handle().generation, second_reg.handle().generation);
+
+    EXPECT_FALSE(evt_bus.remove_handler(first_reg));
+    evt_bus.fire_event(test_event_type{});
+    EXPECT_EQ(first_calls, 0);
+    EXPECT_EQ(second_calls, 1);
+    EXPECT_EQ(evt_bus.handler_count(), 1);
+}
+
+TEST(EventBus, RemoveManyHandlersKeepsRemainingHandlers) {
+    dp::event_bus evt_bus;
+    std::vector<int> calls(1000, 0);
+    std::vector<dp::handler_registration> registrations;
+    for (std::size_t i = 0; i < calls.size(); ++i) {
+        registrations.emplace_back(
+            evt_bus.register_handler<test_event_type>([&calls, i]() { ++calls[i]; }));
+    }
+
+    // remove every handler except each tenth one, forcing several compactions
+    for (std::size_t i = 0; i < registrations.size(); ++i) {
+        if (i % 10 != 0) {
+            EXPECT_TRUE(evt_bus.remove_handler(registrations[i]));
+        }
+    }
+    EXPECT_EQ(evt_bus.handler_count(), 100);
+
+    evt_bus.fire_event(test_event_type{});
+    for (std::size_t i = 0; i < calls.size(); ++i) {
+        EXPECT_EQ(calls[i], i % 10 == 0 ? 1 : 0);
+    }
+
+    // the remaining registrations are still valid after compaction
+    for (std::size_t i = 0; i < registrations.size(); i += 10) {
+        EXPECT_TRUE(evt_bus.remove_handler(registrations[i]));
+    }
+    EXPECT_EQ(evt_bus.handler_count(), 0);
+}
+
+TEST(EventBus, FireEventsInBatches) {
+    dp::event_bus evt_bus;
+    std::vector<int> single_ids;
+    std::vector<std::size_t> batch_sizes;
+    int batch_id_sum{0};
+
+    auto single_reg = evt_bus.register_handler<test_event_type>(
+        [&single_ids](const test_event_type& evt) { single_ids.push_back(evt.id); });
+    auto batch_reg = evt_bus.register_batch_handler<test_event_type>(
+        [&](dp::event_batch<test_event_type> batch) {
+            batch_sizes.push_back(batch.size());
+            for (const auto& evt : batch) {
+                batch_id_sum += evt.id;
+            }
+        });
+
+    std::vector<test_event_type> events;
+    for (auto i = 0; i < 10; ++i) {
+        events.push_back(test_event_type{i, "batch", 1.0});
+    }
+    evt_bus.fire_events(events);
+    evt_bus.fire_event(test_event_type{10, "single", 1.0});
+    evt_bus.fire_events(events.data(), 0);
+
+    ASSERT_EQ(single_ids.size(), 11);
+    for (std::size_t i = 0; i < 11; ++i) {
+        EXPECT_EQ(single_ids[i], static_cast<int>(i));
+    }
+    ASSERT_EQ(batch_sizes.size(), 2);
+    EXPECT_EQ(batch_sizes[0], 10);
+    EXPECT_EQ(batch_sizes[1], 1);
+    EXPECT_EQ(batch_id_sum, 55);
+}
+
+TEST(EventBus, HandlerStorage) {
+    using handler_type = dp::detail::inplace_handler<void(const test_event_type&)>;
+    struct member_delegate {
+        event_handler_counter* instance;
+        void (event_handler_counter::*function)();
+    };
+    static_assert(handler_type::stores_inline<member_delegate>,
+                  "member function handlers must not allocate");
+
+    dp::event_bus evt_bus;
+    event_handler_counter counter;
+    int mutable_calls{0};
+    std::array<double, 64> large_capture{};
+    large_capture[63] = 2.0;
+    double large_sum{0.0};
+
+    std::vector<dp::handler_registration> registrations;
+    registrations.emplace_back(
+        evt_bus.register_handler<test_event_type>(&counter, &event_handler_counter::on_test_event));
+    // mutable lambdas keep their state between calls
+    registrations.emplace_back(evt_bus.register_handler<test_event_type>(
+        [&mutable_calls, calls = 0]() mutable { mutable_calls = ++calls; }));
+    // captures larger than the inline buffer are stored on the heap
+    registrations.emplace_back(evt_bus.register_handler<test_event_type>(
+        [&large_sum, large_capture]() { large_sum += large_capture[63]; }));
+
+    // grow the table several times so the handlers above are copied into new arrays
+    for (auto i = 0; i < 100; ++i) {
+        registrations.emplace_back(evt_bus.register_handler<test_event_type>([]() {}));
+    }
+
+    evt_bus.fire_event(test_event_type{});
+    evt_bus.fire_event(test_event_type{});
+    EXPECT_EQ(counter.get_count(), 2);
+    EXPECT_EQ(mutable_calls, 2);
+    EXPECT_DOUBLE_EQ(large_sum, 4.0);
+}
+
+namespace {
+    struct order_event {
+        int id{0};
+    };
+    struct tagged {
+        int tag{0};
+    };
+    // the order_event base is not at offset 0, so upcasting adjusts the pointer
+    struct limit_order : tagged, order_event {
+        double limit{0.0};
+    };
+    struct stop_limit_order : limit_order {
+        double stop{0.0};
+    };
+}  // namespace
+
+TEST(EventBus, BaseClassHandlers) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        std::vector<std::string> calls;
+
+        auto order_reg = evt_bus.register_handler<order_event>(
+            [&calls](const order_event& evt) {
+                calls.push_back("order " + std::to_string(evt.id));
+            });
+        evt_bus.declare_base<limit_order, order_event>();
+        evt_bus.declare_base<stop_limit_order, limit_order>();
+        // declaring twice has no effect
+        evt_bus.declare_base<stop_limit_order, limit_order>();
+        auto limit_reg = evt_bus.register_handler<limit_order>(
+            [&calls](const limit_order& evt) {
+                calls.push_back("limit " + std::to_string(evt.id));
+            });
+        auto stop_reg = evt_bus.register_handler<stop_limit_order>(
+            [&calls](const stop_limit_order& evt) {
+                calls.push_back("stop " + std::to_string(evt.id));
+            });
+
+        stop_limit_order stop_order;
+        stop_order.id = 1;
+        evt_bus.fire_event(stop_order);
+        EXPECT_EQ(calls, (std::vector<std::string>{"stop 1", "limit 1", "order 1"}));
+
+        // bases do not reach derived handlers
+        calls.clear();
+        evt_bus.fire_event(order_event{2});
+        EXPECT_EQ(calls, (std::vector<std::string>{"order 2"}));
+
+        // base handlers receive batches one event at a time
+        calls.clear();
+        std::vector<limit_order> batch(2);
+        batch[0].id = 3;
+        batch[1].id = 4;
+        evt_bus.fire_events(batch);
+        EXPECT_EQ(calls, (std::vector<std::string>{"limit 3", "limit 4", "order 3", "order 4"}));
+
+        // removing a base handler and registering a new one is picked up
+        calls.clear();
+        EXPECT_TRUE(evt_bus.remove_handler(order_reg));
+        auto second_order_reg = evt_bus.register_handler<order_event>([&calls]() {
+            calls.push_back("second order");
+        });
+        evt_bus.fire_event(stop_order);
+        EXPECT_EQ(calls, (std::vector<std::string>{"stop 1", "limit 1", "second order"}));
+
+        calls.clear();
+        evt_bus.remove_handlers();
+        evt_bus.fire_event(stop_order);
+        EXPECT_TRUE(calls.empty());
+    }
+}
+
+TEST(EventBus, BaseClassHandlersAfterCompaction) {
+    dp::event_bus evt_bus;
+    evt_bus.declare_base<limit_order, order_event>();
+    int order_ids{0};
+
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < 50; ++i) {
+        registrations.emplace_back(evt_bus.register_handler<order_event>(
+            [&order_ids](const order_event& evt) { order_ids += evt.id; }));
+    }
+    // removing most handlers compacts the base handler table several times
+    registrations.erase(registrations.begin() + 1, registrations.end());
+
+    limit_order order;
+    order.id = 7;
+    evt_bus.fire_event(order);
+    EXPECT_EQ(order_ids, 7);
+}
+
+TEST(EventBus, HandlerPriority) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        std::vector<int> order;
+        std::vector<dp::handler_registration> registrations;
+        const auto add = [&](int priority, int id) {
+            registrations.emplace_back(evt_bus.register_handler<test_event_type>(
+                [&order, id]() { order.push_back(id); }, priority));
+        };
+
+        add(0, 1);
+        add(10, 2);
+        add(0, 3);
+        add(-5, 4);
+        add(10, 5);
+        add(5, 6);
+        evt_bus.fire_event(test_event_type{});
+        EXPECT_EQ(order, (std::vector<int>{2, 5, 6, 1, 3, 4}));
+
+        // removing handlers keeps the order of the others
+        order.clear();
+        registrations[1].unregister();
+        registrations[2].unregister();
+        registrations[3].unregister();
+        add(1, 7);
+        evt_bus.fire_event(test_event_type{});
+        EXPECT_EQ(order, (std::vector<int>{5, 6, 7, 1}));
+    }
+}
+
+class event_filter {
+  public:
+    int seen{0};
+    bool on_event(const test_event_type& evt) {
+        ++seen;
+        return evt.id < 0;
+    }
+};
+
+TEST(EventBus, ConsumingHandlersStopPropagation) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        event_filter filter;
+        std::vector<int> handled;
+        std::vector<std::size_t> batch_sizes;
+
+        auto handler_reg = evt_bus.register_handler<test_event_type>(
+            [&handled](const test_event_type& evt) { handled.push_back(evt.id); });
+        auto batch_reg = evt_bus.register_batch_handler<test_event_type>(
+            [&batch_sizes](dp::event_batch<test_event_type> batch) {
+                batch_sizes.push_back(batch.size());
+            },
+            -1);
+        auto filter_reg =
+            evt_bus.register_handler<test_event_type>(&filter, &event_filter::on_event, 100);
+
+        evt_bus.fire_event(test_event_type{1, "priority", 1.0});
+        evt_bus.fire_event(test_event_type{-1, "priority", 1.0});
+        EXPECT_EQ(handled, (std::vector<int>{1}));
+        EXPECT_EQ(batch_sizes, (std::vector<std::size_t>{1}));
+
+        // batches are dispatched one event at a time once a handler can consume events
+        handled.clear();
+        batch_sizes.clear();
+        const std::vector<test_event_type> events{
+            test_event_type{2, "priority", 1.0}, test_event_type{-2, "priority", 1.0},
+            test_event_type{3, "priority", 1.0}};
+        evt_bus.fire_events(events);
+        EXPECT_EQ(filter.seen, 5);
+        EXPECT_EQ(handled, (std::vector<int>{2, 3}));
+        EXPECT_EQ(batch_sizes, (std::vector<std::size_t>{1, 1}));
+
+        // the whole batch is passed on again once the consuming handler is gone
+        handled.clear();
+        batch_sizes.clear();
+        filter_reg.unregister();
+        evt_bus.fire_events(events);
+        EXPECT_EQ(handled, (std::vector<int>{2, -2, 3}));
+        EXPECT_EQ(batch_sizes, (std::vector<std::size_t>{3}));
+    }
+}
+
+TEST(EventBus, PriorityAcrossBaseClasses) {
+    dp::event_bus evt_bus;
+    evt_bus.declare_base<limit_order, order_event>();
+    std::vector<std::string> calls;
+
+    auto limit_reg =
+        evt_bus.register_handler<limit_order>([&calls]() { calls.push_back("limit"); });
+    auto order_reg = evt_bus.register_handler<order_event>(
+        [&calls](const order_event& evt) {
+            calls.push_back("order filter");
+            return evt.id == 0;
+        },
+        1);
+
+    limit_order order;
+    order.id = 0;
+    evt_bus.fire_event(order);
+    EXPECT_EQ(calls, (std::vector<std::string>{"order filter"}));
+
+    calls.clear();
+    order.id = 1;
+    evt_bus.fire_event(order);
+    EXPECT_EQ(calls, (std::vector<std::string>{"order filter", "limit"}));
+}
+
+namespace {
+    struct quote_event {
+        std::string symbol;
+        int venue{0};
+        double price{0.0};
+    };
+}  // namespace
+
+TEST(EventBus, KeyedHandlers) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        std::vector<std::string> calls;
+
+        std::vector<dp::handler_registration> registrations;
+        for (const auto* symbol : {"AAPL", "MSFT", "GOOG", "AMZN"}) {
+            registrations.push_back(evt_bus.register_handler<quote_event>(
+                &quote_event::symbol, symbol,
+                [&calls](const quote_event& evt) { calls.push_back(evt.symbol); }));
+        }
+        auto venue_reg = evt_bus.register_handler<quote_event>(
+            [](const quote_event& evt) { return evt.venue; }, 2,
+            [&calls]() { calls.push_back("venue 2"); });
+        auto all_reg =
+            evt_bus.register_handler<quote_event>([&calls]() { calls.push_back("all"); });
+        EXPECT_EQ(evt_bus.handler_count(), 6);
+
+        // handlers without a key run first
+        evt_bus.fire_event(quote_event{"MSFT", 2, 1.0});
+        EXPECT_EQ(calls, (std::vector<std::string>{"all", "MSFT", "venue 2"}));
+
+        calls.clear();
+        evt_bus.fire_event(quote_event{"IBM", 1, 1.0});
+        EXPECT_EQ(calls, (std::vector<std::string>{"all"}));
+
+        // batches are matched event by event
+        calls.clear();
+        const std::vector<quote_event> events{quote_event{"GOOG", 0, 1.0},
+                                              quote_event{"AAPL", 2, 1.0}};
+        evt_bus.fire_events(events);
+        EXPECT_EQ(calls,
+                  (std::vector<std::string>{"all", "GOOG", "all", "AAPL", "venue 2"}));
+
+        calls.clear();
+        registrations[1].unregister();
+        registrations[2].unregister();
+        evt_bus.fire_event(quote_event{"MSFT", 0, 1.0});
+        evt_bus.fire_event(quote_event{"GOOG", 0, 1.0});
+        evt_bus.fire_event(quote_event{"AMZN", 0, 1.0});
+        EXPECT_EQ(calls, (std::vector<std::string>{"all", "all", "all", "AMZN"}));
+        EXPECT_EQ(evt_bus.handler_count(), 4);
+
+        calls.clear();
+        evt_bus.remove_handlers();
+        evt_bus.fire_event(quote_event{"AAPL", 2, 1.0});
+        EXPECT_TRUE(calls.empty());
+        registrations.push_back(evt_bus.register_handler<quote_event>(
+            &quote_event::symbol, "AAPL", [&calls]() { calls.push_back("AAPL again"); }));
+        evt_bus.fire_event(quote_event{"AAPL", 2, 1.0});
+        EXPECT_EQ(calls, (std::vector<std::string>{"AAPL again"}));
+    }
+}
+
+TEST(EventBus, KeyedHandlerPriorityAndConsumption) {
+    dp::event_bus evt_bus;
+    std::vector<std::string> calls;
+
+    auto low_reg = evt_bus.register_handler<quote_event>(
+        &quote_event::symbol, "AAPL", [&calls]() { calls.push_back("low"); }, -1);
+    auto high_reg = evt_bus.register_handler<quote_event>(
+        &quote_event::symbol, "AAPL",
+        [&calls](const quote_event& evt) {
+            calls.push_back("high");
+            return evt.price < 0.0;
+        },
+        1);
+    // a different member pointer of the same type is a different key extractor
+    auto venue_reg = evt_bus.register_handler<quote_event>(
+        &quote_event::venue, 1, [&calls]() { calls.push_back("venue"); });
+
+    evt_bus.fire_event(quote_event{"AAPL", 0, 1.0});
+    EXPECT_EQ(calls, (std::vector<std::string>{"high", "low"}));
+
+    calls.clear();
+    evt_bus.fire_event(quote_event{"AAPL", 1, -1.0});
+    EXPECT_EQ(calls, (std::vector<std::string>{"high"}));
+
+    calls.clear();
+    evt_bus.fire_event(quote_event{"MSFT", 1, -1.0});
+    EXPECT_EQ(calls, (std::vector<std::string>{"venue"}));
+}
+
+TEST(EventBus, ManyKeyedHandlers) {
+    dp::event_bus evt_bus;
+    constexpr int key_count = 1000;
+    std::vector<int> hits(key_count, 0);
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < key_count; ++i) {
+        registrations.push_back(evt_bus.register_handler<quote_event>(
+            &quote_event::venue, i, [&hits, i]() { ++hits[static_cast<std::size_t>(i)]; }));
+    }
+    // remove every other handler, which compacts the keyed handlers
+    for (int i = 0; i < key_count; i += 2) {
+        registrations[static_cast<std::size_t>(i)].unregister();
+    }
+    for (int i = 0; i < key_count; ++i) {
+        evt_bus.fire_event(quote_event{"", i, 1.0});
+    }
+    for (int i = 0; i < key_count; ++i) {
+        EXPECT_EQ(hits[static_cast<std::size_t>(i)], i % 2);
+    }
+}
+
+namespace {
+    struct connection_status {
+        std::string endpoint;
+        bool connected{false};
+    };
+}  // namespace
+
+TEST(EventBus, StickyEventsReachLateHandlers) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        std::vector<std::string> calls;
+        evt_bus.make_sticky<connection_status>();
+        EXPECT_FALSE(evt_bus.sticky_event<connection_status>().has_value());
+
+        // nothing fired yet, nothing to deliver
+        auto early_reg = evt_bus.register_handler<connection_status>(
+            [&calls](const connection_status& evt) { calls.push_back("early " + evt.endpoint); });
+        EXPECT_TRUE(calls.empty());
+
+        evt_bus.fire_event(connection_status{"primary", true});
+        evt_bus.fire_event(connection_status{"backup", true});
+        EXPECT_EQ(calls, (std::vector<std::string>{"early primary", "early backup"}));
+        EXPECT_EQ(evt_bus.sticky_event<connection_status>()->endpoint, "backup");
+
+        // the most recent event is delivered once, during registration
+        calls.clear();
+        auto late_reg = evt_bus.register_handler<connection_status>(
+            [&calls](const connection_status& evt) { calls.push_back("late " + evt.endpoint); });
+        EXPECT_EQ(calls, (std::vector<std::string>{"late backup"}));
+
+        calls.clear();
+        auto keyed_reg = evt_bus.register_handler<connection_status>(
+            &connection_status::endpoint, "backup", [&calls]() { calls.push_back("keyed"); });
+        auto other_key_reg = evt_bus.register_handler<connection_status>(
+            &connection_status::endpoint, "primary", [&calls]() { calls.push_back("other"); });
+        EXPECT_EQ(calls, (std::vector<std::string>{"keyed"}));
+
+        // batches cache their last event
+        calls.clear();
+        const std::vector<connection_status> batch{{"a", false}, {"b", false}};
+        evt_bus.fire_events(batch);
+        auto batch_reg = evt_bus.register_batch_handler<connection_status>(
+            [&calls](dp::event_batch<connection_status> events) {
+                calls.push_back("batch " + events[0].endpoint);
+            });
+        EXPECT_EQ(calls.back(), "batch b");
+
+        calls.clear();
+        evt_bus.clear_sticky_event<connection_status>();
+        EXPECT_FALSE(evt_bus.sticky_event<connection_status>().has_value());
+        auto cleared_reg = evt_bus.register_handler<connection_status>(
+            [&calls]() { calls.push_back("cleared"); });
+        EXPECT_TRUE(calls.empty());
+
+        // types that are not sticky are not cached
+        evt_bus.fire_event(test_event_type{1, "not sticky", 1.0});
+        EXPECT_FALSE(evt_bus.sticky_event<test_event_type>().has_value());
+        auto plain_reg = evt_bus.register_handler<test_event_type>(
+            [&calls]() { calls.push_back("plain"); });
+        EXPECT_TRUE(calls.empty());
+    }
+}
+
+TEST(EventBus, StickyEventForHandlersRegisteredByHandlers) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        evt_bus.make_sticky<connection_status>();
+        evt_bus.fire_event(connection_status{"primary", true});
+
+        std::vector<std::string> calls;
+        std::vector<dp::handler_registration> registrations;
+        auto trigger_reg = evt_bus.register_handler<test_event_type>([&]() {
+            registrations.push_back(evt_bus.register_handler<connection_status>(
+                [&calls](const connection_status& evt) {
+                    calls.push_back("nested " + evt.endpoint);
+                    return false;
+                }));
+        });
+        evt_bus.fire_event(test_event_type{});
+        // delivered once the registration took effect
+        EXPECT_EQ(calls, (std::vector<std::string>{"nested primary"}));
+
+        // a handler receiving the cached event may fire the type again
+        calls.clear();
+        auto refire_reg = evt_bus.register_handler<connection_status>(
+            [&](const connection_status& evt) {
+                if (evt.endpoint == "primary") {
+                    evt_bus.fire_event(connection_status{"refired", true});
+                }
+            });
+        EXPECT_EQ(calls, (std::vector<std::string>{"nested refired"}));
+        EXPECT_EQ(evt_bus.sticky_event<connection_status>()->endpoint, "refired");
+    }
+}
+
+TEST(EventBus, StickyEventIsNotMissedByConcurrentRegistration) {
+    dp::event_bus evt_bus(dp::dispatch_mode::lock_free);
+    evt_bus.make_sticky<connection_status>();
+    constexpr int rounds = 200;
+    std::atomic<bool> stop{false};
+    std::thread firing([&]() {
+        for (int i = 0; !stop.load(); ++i) {
+            evt_bus.fire_event(connection_status{std::to_string(i), true});
+        }
+    });
+    for (int i = 0; i < rounds; ++i) {
+        while (!evt_bus.sticky_event<connection_status>()) {
+            std::this_thread::yield();
+        }
+        std::atomic<int> received{0};
+        auto reg = evt_bus.register_handler<connection_status>(
+            [&received]() { received.fetch_add(1); });
+        // the cached event is delivered before register_handler returns
+        EXPECT_GE(received.load(), 1);
+    }
+    stop = true;
+    firing.join();
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <eventbus/event_bus.hpp>
+#include <eventbus/event_journal.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct fill_event {
+        std::uint32_t order_id{0};
+        double price{0};
+    };
+
+    struct note_event {
+        std::string text;
+    };
+
+    struct unrecorded_event {};
+
+    // a unique file per test and process, removed when the test ends
+    class journal_path {
+      public:
+        explicit journal_path(const char* test)
+            : path_(::testing::TempDir() + "eventbus_" + test + "_" +
+                    std::to_string(::getpid()) + ".journal") {}
+        ~journal_path() { std::remove(path_.c_str()); }
+        [[nodiscard]] const std::string& get() const { return path_; }
+
+      private:
+        std::string path_;
+    };
+}  // namespace
+
+template <>
+struct dp::journal_codec<note_event> {
+    static std::size_t size(const note_event& evt) { return evt.text.size(); }
+    static void write(const note_event& evt, unsigned char* destination) {
+        std::memcpy(destination, evt.text.data(), evt.text.size());
+    }
+    static note_event read(const unsigned char* source, std::size_t size) {
+        return {std::string(reinterpret_cast<const char*>(source), size)};
+    }
+};
+
+TEST(EventJournal, RecordAndReplay) {
+    const journal_path path("record");
+    {
+        dp::event_bus evt_bus;
+        dp::event_journal journal(path.get(), 1 << 16);
+        auto fill_recording = journal.record<fill_event>(evt_bus);
+        auto note_recording = journal.record<note_event>(evt_bus);
+        // consuming handlers do not hide events from the journal
+        auto consumer = evt_bus.register_handler<fill_event>([]() { return true; });
+
+        evt_bus.fire_event(fill_event{1, 10.5});
+        evt_bus.fire_event(note_event{"partial"});
+        evt_bus.fire_event(unrecorded_event{});
+        evt_bus.fire_event(fill_event{2, 11.5});
+        note_recording.unregister();
+        evt_bus.fire_event(note_event{"not recorded"});
+        EXPECT_EQ(journal.dropped(), 0);
+        journal.sync();
+    }
+
+    dp::event_bus replay_bus;
+    std::vector<std::string> replayed;
+    auto fill_reg = replay_bus.register_handler<fill_event>([&replayed](const fill_event& evt) {
+        replayed.push_back(std::to_string(evt.order_id) + "@" + std::to_string(evt.price));
+    });
+    auto note_reg = replay_bus.register_handler<note_event>(
+        [&replayed](const note_event& evt) { replayed.push_back(evt.text); });
+
+    dp::journal_replayer replayer(path.get());
+    replayer.add_type<fill_event>();
+    // without note_event, its records are skipped
+    EXPECT_EQ(replayer.replay(replay_bus), 2);
+    replayer.add_type<note_event>();
+    EXPECT_EQ(replayer.replay(replay_bus), 3);
+    EXPECT_EQ(replayed, (std::vector<std::string>{"1@10.500000", "2@11.500000", "1@10.500000",
+                                                  "partial", "2@11.500000"}));
+}
+
+TEST(EventJournal, PacedReplayKeepsRecordedGaps) {
+    const journal_path path("paced");
+    constexpr auto gap = std::chrono::milliseconds(30);
+    {
+        dp::event_journal journal(path.get(), 4096);
+        journal.append(fill_event{1, 1});
+        std::this_thread::sleep_for(gap);
+        journal.append(fill_event{2, 2});
+    }
+
+    dp::event_bus replay_bus;
+    std::vector<std::chrono::steady_clock::time_point> fired;
+    auto registration = replay_bus.register_handler<fill_event>(
+        [&fired]() { fired.push_back(std::chrono::steady_clock::now()); });
+    dp::journal_replayer replayer(path.get());
+    replayer.add_type<fill_event>();
+
+    EXPECT_EQ(replayer.replay(replay_bus, dp::replay_pacing::recorded), 2);
+    ASSERT_EQ(fired.size(), 2);
+    EXPECT_GE(fired[1] - fired[0], gap - std::chrono::milliseconds(5));
+}
+
+TEST(EventJournal, FullJournalDropsEvents) {
+    const journal_path path("full");
+    std::size_t recorded_size{0};
+    {
+        // room for the header and four records of fill_event
+        dp::event_journal journal(path.get(), 64 + 4 * 40);
+        for (std::uint32_t i = 0; i < 10; ++i) {
+            EXPECT_EQ(journal.append(fill_event{i, 0}), i < 4);
+        }
+        EXPECT_EQ(journal.dropped(), 6);
+        recorded_size = journal.size();
+    }
+    EXPECT_EQ(recorded_size, 64 + 4 * 40);
+
+    dp::event_bus replay_bus;
+    std::vector<std::uint32_t> orders;
+    auto registration = replay_bus.register_handler<fill_event>(
+        [&orders](const fill_event& evt) { orders.push_back(evt.order_id); });
+    dp::journal_replayer replayer(path.get());
+    replayer.add_type<fill_event>();
+    EXPECT_EQ(replayer.replay(replay_bus), 4);
+    EXPECT_EQ(orders, (std::vector<std::uint32_t>{0, 1, 2, 3}));
+}
+
+TEST(EventJournal, RecordFromManyThreads) {
+    constexpr std::uint32_t thread_count = 4;
+    constexpr std::uint32_t events_per_thread = 5000;
+    const journal_path path("threads");
+    {
+        dp::event_bus evt_bus;
+        dp::event_journal journal(path.get(), 1 << 20);
+        auto recording = journal.record<fill_event>(evt_bus);
+        std::vector<std::thread> threads;
+        for (std::uint32_t t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&evt_bus, t]() {
+                for (std::uint32_t i = 0; i < events_per_thread; ++i) {
+                    evt_bus.fire_event(fill_event{t * events_per_thread + i, 0});
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(journal.dropped(), 0);
+    }
+
+    dp::event_bus replay_bus;
+    std::vector<int> seen(thread_count * events_per_thread, 0);
+    auto registration = replay_bus.register_handler<fill_event>(
+        [&seen](const fill_event& evt) { ++seen[evt.order_id]; });
+    dp::journal_replayer replayer(path.get());
+    replayer.add_type<fill_event>();
+    EXPECT_EQ(replayer.replay(replay_bus), thread_count * events_per_thread);
+    for (const auto count : seen) {
+        EXPECT_EQ(count, 1);
+    }
+}
+
+TEST(EventJournal, RejectsOtherFiles) {
+    const journal_path path("invalid");
+    {
+        std::FILE* file = std::fopen(path.get().c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        const std::vector<char> garbage(128, 'x');
+        std::fwrite(garbage.data(), 1, garbage.size(), file);
+        std::fclose(file);
+    }
+    EXPECT_THROW(dp::journal_replayer replayer(path.get()), std::system_error);
+    EXPECT_THROW(dp::journal_replayer replayer(path.get() + ".missing"), std::system_error);
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <eventbus/event_bus.hpp>
+#include <eventbus/event_scheduler.hpp>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using namespace std::chrono_literals;
+
+    struct timeout_event {
+        int id{0};
+    };
+
+    struct heartbeat_event {
+        std::string source;
+    };
+
+    template <typename Predicate>
+    bool wait_until(Predicate&& predicate, std::chrono::milliseconds timeout = 5s) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!predicate()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+}  // namespace
+
+TEST(EventScheduler, FiresDelayedEventOnce) {
+    dp::event_bus evt_bus;
+    std::atomic<int> fired{0};
+    std::chrono::steady_clock::time_point fired_at;
+    auto reg = evt_bus.register_handler<timeout_event>([&](const timeout_event& evt) {
+        EXPECT_EQ(evt.id, 7);
+        fired_at = std::chrono::steady_clock::now();
+        fired.fetch_add(1);
+    });
+
+    dp::event_scheduler scheduler(evt_bus);
+    const auto start = std::chrono::steady_clock::now();
+    auto timer = scheduler.schedule_event(timeout_event{7}, 20ms);
+    EXPECT_EQ(scheduler.pending(), 1);
+    ASSERT_TRUE(wait_until([&]() { return fired.load() == 1; }));
+    EXPECT_GE(fired_at - start, 20ms);
+    EXPECT_TRUE(wait_until([&]() { return scheduler.pending() == 0; }));
+
+    std::this_thread::sleep_for(30ms);
+    EXPECT_EQ(fired.load(), 1);
+    // fired already, nothing left to cancel
+    EXPECT_FALSE(timer.cancel());
+}
+
+TEST(EventScheduler, PeriodicEventFiresUntilCancelled) {
+    dp::event_bus evt_bus;
+    std::atomic<int> beats{0};
+    auto reg = evt_bus.register_handler<heartbeat_event>([&beats](const heartbeat_event& evt) {
+        EXPECT_EQ(evt.source, "service");
+        beats.fetch_add(1);
+    });
+
+    dp::event_scheduler scheduler(evt_bus);
+    auto timer = scheduler.schedule_periodic(heartbeat_event{"service"}, 5ms);
+    ASSERT_TRUE(wait_until([&]() { return beats.load() >= 3; }));
+    EXPECT_EQ(scheduler.pending(), 1);
+    EXPECT_TRUE(timer.cancel());
+    EXPECT_EQ(scheduler.pending(), 0);
+
+    const auto after_cancel = beats.load();
+    std::this_thread::sleep_for(30ms);
+    EXPECT_EQ(beats.load(), after_cancel);
+}
+
+TEST(EventScheduler, CancelledAndDestroyedTimersDoNotFire) {
+    dp::event_bus evt_bus;
+    std::atomic<int> fired{0};
+    auto reg = evt_bus.register_handler<timeout_event>([&fired]() { fired.fetch_add(1); });
+
+    dp::event_scheduler scheduler(evt_bus);
+    // the timers that are cancelled are not due before the test is done
+    auto cancelled = scheduler.schedule_event(timeout_event{1}, 1h);
+    EXPECT_TRUE(cancelled.cancel());
+    EXPECT_FALSE(cancelled.cancel());
+    { auto destroyed = scheduler.schedule_event(timeout_event{2}, 1h); }
+    auto overwritten = scheduler.schedule_event(timeout_event{3}, 1h);
+    overwritten = scheduler.schedule_event(timeout_event{4}, 10ms);
+    scheduler.schedule_event(timeout_event{5}, 10ms).release();
+
+    ASSERT_TRUE(wait_until([&]() { return fired.load() == 2; }));
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ(fired.load(), 2);
+    EXPECT_EQ(scheduler.pending(), 0);
+}
+
+TEST(EventScheduler, FiresInDueOrderAcrossWheelLevels) {
+    dp::event_bus evt_bus;
+    std::mutex order_mutex;
+    std::vector<int> order;
+    auto reg = evt_bus.register_handler<timeout_event>([&](const timeout_event& evt) {
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(evt.id);
+    });
+
+    // with 1us ticks the delays land on the first three levels of the wheel
+    dp::event_scheduler scheduler(evt_bus, 1us);
+    std::vector<dp::timer_registration> timers;
+    timers.push_back(scheduler.schedule_event(timeout_event{4}, 90ms));
+    timers.push_back(scheduler.schedule_event(timeout_event{2}, 5ms));
+    timers.push_back(scheduler.schedule_event(timeout_event{3}, 30ms));
+    timers.push_back(scheduler.schedule_event(timeout_event{1}, 100us));
+
+    ASSERT_TRUE(wait_until([&]() { return scheduler.pending() == 0; }));
+    EXPECT_EQ(order, (std::vector<int>{1, 2, 3, 4}));
+}
+
+TEST(EventScheduler, HandlersScheduleAndCancelTimers) {
+    dp::event_bus evt_bus;
+    dp::event_scheduler scheduler(evt_bus);
+    std::atomic<int> beats{0};
+    std::atomic<int> timeouts{0};
+    std::mutex heartbeat_mutex;
+    std::optional<dp::timer_registration> heartbeat;
+    std::vector<dp::timer_registration> follow_ups;
+
+    auto beat_reg = evt_bus.register_handler<heartbeat_event>([&]() {
+        if (beats.fetch_add(1) + 1 == 3) {
+            // handlers run on the driver thread
+            std::lock_guard<std::mutex> lock(heartbeat_mutex);
+            heartbeat->cancel();
+            follow_ups.push_back(scheduler.schedule_event(timeout_event{}, 1ms));
+        }
+    });
+    auto timeout_reg =
+        evt_bus.register_handler<timeout_event>([&timeouts]() { timeouts.fetch_add(1); });
+
+    {
+        std::lock_guard<std::mutex> lock(heartbeat_mutex);
+        heartbeat = scheduler.schedule_periodic(heartbeat_event{"self"}, 2ms);
+    }
+    ASSERT_TRUE(wait_until([&]() { return timeouts.load() == 1; }));
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ(beats.load(), 3);
+    EXPECT_EQ(timeouts.load(), 1);
+}
+
+TEST(EventScheduler, HoldsManyTimers) {
+    dp::event_bus evt_bus;
+    std::atomic<int> fired{0};
+    auto reg = evt_bus.register_handler<timeout_event>([&fired]() { fired.fetch_add(1); });
+
+    dp::event_scheduler scheduler(evt_bus);
+    // due long after the test is done, so none of them fires while they are cancelled
+    constexpr std::size_t timer_count = 100000;
+    std::vector<dp::timer_registration> timers;
+    timers.reserve(timer_count);
+    for (std::size_t i = 0; i < timer_count; ++i) {
+        const auto delay = 1h + std::chrono::milliseconds(static_cast<int>(i % 200));
+        timers.push_back(scheduler.schedule_event(timeout_event{static_cast<int>(i)}, delay));
+    }
+    EXPECT_EQ(scheduler.pending(), timer_count);
+
+    // cancel every other timer
+    for (std::size_t i = 0; i < timer_count; i += 2) {
+        EXPECT_TRUE(timers[i].cancel());
+    }
+    EXPECT_EQ(scheduler.pending(), timer_count / 2);
+
+    // timers due soon fire next to the pending ones
+    constexpr int due_count = 1000;
+    for (int i = 0; i < due_count; ++i) {
+        scheduler.schedule_event(timeout_event{i}, std::chrono::milliseconds(i % 20)).release();
+    }
+    ASSERT_TRUE(wait_until([&]() { return fired.load() == due_count; }, 20s));
+    EXPECT_EQ(scheduler.pending(), timer_count / 2);
+
+    timers.clear();
+    EXPECT_EQ(scheduler.pending(), 0);
+    EXPECT_EQ(fired.load(), due_count);
+}
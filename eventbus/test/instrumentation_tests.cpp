@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <eventbus/event_bus.hpp>
+#include <stdexcept>
+#include <thread>
+
+static_assert(EVENTBUS_ENABLE_INSTRUMENTATION, "This test must be built with instrumentation.");
+
+namespace {
+    struct tick_event {
+        int value{0};
+    };
+
+    struct other_event {};
+
+    const dp::event_type_stats* find_type(const dp::event_bus_stats& stats,
+                                          const dp::handler_registration& registration) {
+        for (const auto& type_stats : stats.event_types) {
+            if (type_stats.event_type == registration.handle().event_type) {
+                return &type_stats;
+            }
+        }
+        return nullptr;
+    }
+}  // namespace
+
+TEST(Instrumentation, CountsFiresAndHandlerCalls) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        int sum{0};
+        auto first = evt_bus.register_handler<tick_event>(
+            [&sum](const tick_event& evt) { sum += evt.value; });
+        auto second = evt_bus.register_handler<tick_event>([]() {});
+        auto other = evt_bus.register_handler<other_event>([]() {});
+
+        for (int i = 0; i < 3; ++i) {
+            evt_bus.fire_event(tick_event{i});
+        }
+        const std::array<tick_event, 2> batch{tick_event{10}, tick_event{20}};
+        evt_bus.fire_events(batch);
+
+        const auto stats = evt_bus.stats();
+        const auto* type_stats = find_type(stats, first);
+        ASSERT_NE(type_stats, nullptr);
+        EXPECT_EQ(type_stats->fires, 4);
+        EXPECT_EQ(type_stats->events, 5);
+        EXPECT_EQ(type_stats->dispatch_latency.count(), 4);
+        ASSERT_EQ(type_stats->handlers.size(), 2);
+        EXPECT_EQ(type_stats->handlers[0].handle.slot, first.handle().slot);
+        EXPECT_EQ(type_stats->handlers[0].handle.generation, first.handle().generation);
+        EXPECT_EQ(type_stats->handlers[1].handle.slot, second.handle().slot);
+        for (const auto& handler_stats : type_stats->handlers) {
+            EXPECT_EQ(handler_stats.calls, 4);
+            EXPECT_EQ(handler_stats.exceptions, 0);
+            EXPECT_EQ(handler_stats.latency.count(), 4);
+        }
+        EXPECT_EQ(sum, 33);
+
+        const auto* other_stats = find_type(stats, other);
+        ASSERT_NE(other_stats, nullptr);
+        EXPECT_EQ(other_stats->fires, 0);
+        EXPECT_EQ(other_stats->handlers.size(), 1);
+
+        // three registrations took the exclusive lock
+        EXPECT_GE(stats.exclusive_lock_wait.count(), 3);
+        if (mode == dp::dispatch_mode::locked) {
+            EXPECT_GE(stats.shared_lock_wait.count(), 4);
+        }
+    }
+}
+
+TEST(Instrumentation, CountsHandlerExceptions) {
+    dp::event_bus evt_bus;
+    int calls{0};
+    auto throwing = evt_bus.register_handler<tick_event>(
+        [](const tick_event&) { throw std::runtime_error("handler failed"); });
+    auto counting = evt_bus.register_handler<tick_event>([&calls]() { ++calls; });
+
+    evt_bus.fire_event(tick_event{});
+    evt_bus.fire_event(tick_event{});
+
+    // the throwing handler does not keep the others from running
+    EXPECT_EQ(calls, 2);
+    const auto stats = evt_bus.stats();
+    const auto* type_stats = find_type(stats, throwing);
+    ASSERT_NE(type_stats, nullptr);
+    ASSERT_EQ(type_stats->handlers.size(), 2);
+    EXPECT_EQ(type_stats->handlers[0].exceptions, 2);
+    EXPECT_EQ(type_stats->handlers[1].exceptions, 0);
+}
+
+TEST(Instrumentation, RemovedHandlersAreNotReported) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::event_bus evt_bus(mode);
+        auto kept = evt_bus.register_handler<tick_event>([]() {});
+        {
+            auto removed = evt_bus.register_handler<tick_event>([]() {});
+            evt_bus.fire_event(tick_event{});
+        }
+        evt_bus.fire_event(tick_event{});
+
+        auto stats = evt_bus.stats();
+        const auto* type_stats = find_type(stats, kept);
+        ASSERT_NE(type_stats, nullptr);
+        EXPECT_EQ(type_stats->fires, 2);
+        ASSERT_EQ(type_stats->handlers.size(), 1);
+        EXPECT_EQ(type_stats->handlers[0].handle.slot, kept.handle().slot);
+        EXPECT_EQ(type_stats->handlers[0].calls, 2);
+
+        // the type is still reported after all handlers are gone since it was fired
+        evt_bus.remove_handlers();
+        stats = evt_bus.stats();
+        type_stats = find_type(stats, kept);
+        ASSERT_NE(type_stats, nullptr);
+        EXPECT_TRUE(type_stats->handlers.empty());
+    }
+}
+
+TEST(Instrumentation, SlowHandlerShowsInPercentiles) {
+    dp::event_bus evt_bus;
+    auto fast = evt_bus.register_handler<tick_event>([]() {});
+    auto slow = evt_bus.register_handler<tick_event>(
+        []() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+
+    for (int i = 0; i < 5; ++i) {
+        evt_bus.fire_event(tick_event{});
+    }
+
+    const auto stats = evt_bus.stats();
+    const auto* type_stats = find_type(stats, slow);
+    ASSERT_NE(type_stats, nullptr);
+    ASSERT_EQ(type_stats->handlers.size(), 2);
+    const auto& slow_latency = type_stats->handlers[1].latency;
+    EXPECT_GE(slow_latency.percentile_ns(0.99), 2'000'000);
+    EXPECT_GE(slow_latency.total_ns, 5 * 2'000'000);
+    EXPECT_LT(type_stats->handlers[0].latency.percentile_ns(0.99), 2'000'000);
+}
+
+TEST(Instrumentation, LatencyHistogram) {
+    dp::latency_histogram histogram;
+    EXPECT_EQ(histogram.count(), 0);
+    EXPECT_EQ(histogram.percentile_ns(0.5), 0);
+
+    dp::detail::atomic_histogram recorder;
+    recorder.record(std::chrono::nanoseconds(1));
+    for (int i = 0; i < 98; ++i) {
+        recorder.record(std::chrono::nanoseconds(100));
+    }
+    recorder.record(std::chrono::microseconds(100));
+
+    histogram = recorder.snapshot();
+    EXPECT_EQ(histogram.count(), 100);
+    EXPECT_EQ(histogram.buckets[0], 1);
+    // 100ns falls in [64, 128)
+    EXPECT_EQ(histogram.buckets[6], 98);
+    EXPECT_EQ(histogram.percentile_ns(0.0), 2);
+    EXPECT_EQ(histogram.percentile_ns(0.5), 128);
+    // 100us falls in [65536, 131072)
+    EXPECT_EQ(histogram.percentile_ns(1.0), 131072);
+    EXPECT_EQ(histogram.total_ns, 1 + 98 * 100 + 100'000);
+}
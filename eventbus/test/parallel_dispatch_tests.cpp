@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <eventbus/event_bus.hpp>
+#include <eventbus/work_stealing_pool.hpp>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct fan_out_event {
+        int value{0};
+    };
+
+    struct message_event {
+        std::string message;
+        int id{0};
+    };
+
+    constexpr int handler_count = 64;
+}  // namespace
+
+TEST(WorkStealingPool, RunsSubmittedTasks) {
+    std::atomic<int> counter{0};
+    {
+        dp::work_stealing_pool pool(3);
+        EXPECT_EQ(pool.thread_count(), 3);
+        for (int i = 0; i < 1000; ++i) {
+            pool.submit([&counter]() { counter.fetch_add(1); });
+        }
+    }
+    // the destructor runs the remaining tasks
+    EXPECT_EQ(counter.load(), 1000);
+}
+
+TEST(WorkStealingPool, IdleWorkersStealTasksOfBusyOnes) {
+    std::atomic<int> counter{0};
+    std::mutex threads_mutex;
+    std::set<std::thread::id> threads;
+    {
+        dp::work_stealing_pool pool(2);
+        // every task submitted by a worker goes to its own queue, the other worker has to steal
+        pool.submit([&]() {
+            for (int i = 0; i < 100; ++i) {
+                pool.submit([&]() {
+                    {
+                        std::lock_guard<std::mutex> lock(threads_mutex);
+                        threads.insert(std::this_thread::get_id());
+                    }
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    counter.fetch_add(1);
+                });
+            }
+        });
+    }
+    EXPECT_EQ(counter.load(), 100);
+    EXPECT_EQ(threads.size(), 2);
+}
+
+TEST(ParallelDispatch, CallsEveryHandlerOnceWithTheSameEvent) {
+    dp::event_bus evt_bus;
+    dp::work_stealing_pool pool(4);
+    std::atomic<int> calls{0};
+    std::atomic<const fan_out_event*> mismatched{nullptr};
+    const fan_out_event evt{42};
+
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < handler_count; ++i) {
+        registrations.push_back(
+            evt_bus.register_handler<fan_out_event>([&](const fan_out_event& received) {
+                if (&received != &evt || received.value != 42) {
+                    mismatched = &received;
+                }
+                calls.fetch_add(1);
+            }));
+    }
+
+    evt_bus.fire_event_parallel(evt, pool);
+    // all handlers returned before fire_event_parallel did
+    EXPECT_EQ(calls.load(), handler_count);
+    EXPECT_EQ(mismatched.load(), nullptr);
+}
+
+TEST(ParallelDispatch, RunsHandlersOnPoolThreads) {
+    dp::event_bus evt_bus(dp::dispatch_mode::lock_free);
+    dp::work_stealing_pool pool(2);
+    std::mutex threads_mutex;
+    std::set<std::thread::id> threads;
+
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < 8; ++i) {
+        registrations.push_back(evt_bus.register_handler<fan_out_event>([&]() {
+            {
+                std::lock_guard<std::mutex> lock(threads_mutex);
+                threads.insert(std::this_thread::get_id());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }));
+    }
+    evt_bus.fire_event_parallel(fan_out_event{}, pool);
+    EXPECT_GT(threads.size(), 1);
+}
+
+TEST(ParallelDispatch, AsyncFireCompletesToken) {
+    dp::event_bus evt_bus;
+    dp::work_stealing_pool pool(2);
+    std::atomic<int> calls{0};
+    std::atomic<bool> release{false};
+
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < handler_count; ++i) {
+        registrations.push_back(evt_bus.register_handler<message_event>(
+            [&](const message_event& evt) {
+                while (!release.load()) {
+                    std::this_thread::yield();
+                }
+                if (evt.message == "hello") {
+                    calls.fetch_add(1);
+                }
+            }));
+    }
+
+    auto token = evt_bus.fire_event_async(message_event{"hello", 1}, pool);
+    EXPECT_FALSE(token.ready());
+    EXPECT_FALSE(token.wait_for(std::chrono::milliseconds(1)));
+    release = true;
+    token.wait();
+    EXPECT_TRUE(token.ready());
+    EXPECT_EQ(calls.load(), handler_count);
+    EXPECT_TRUE(dp::completion_token{}.ready());
+}
+
+TEST(ParallelDispatch, PerTypeSetting) {
+    dp::event_bus evt_bus;
+    dp::work_stealing_pool pool(2);
+    std::mutex threads_mutex;
+    std::set<std::thread::id> threads;
+
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < 8; ++i) {
+        registrations.push_back(evt_bus.register_handler<fan_out_event>([&]() {
+            {
+                std::lock_guard<std::mutex> lock(threads_mutex);
+                threads.insert(std::this_thread::get_id());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }));
+    }
+
+    evt_bus.fire_event(fan_out_event{});
+    EXPECT_EQ(threads.size(), 1);
+
+    evt_bus.dispatch_in_parallel<fan_out_event>(&pool);
+    threads.clear();
+    evt_bus.fire_event(fan_out_event{});
+    EXPECT_GT(threads.size(), 1);
+
+    evt_bus.dispatch_in_parallel<fan_out_event>(nullptr);
+    threads.clear();
+    evt_bus.fire_event(fan_out_event{});
+    EXPECT_EQ(threads.size(), 1);
+    EXPECT_EQ(*threads.begin(), std::this_thread::get_id());
+}
+
+TEST(ParallelDispatch, HandlersRegisterAndFireDuringParallelDispatch) {
+    dp::event_bus evt_bus;
+    dp::work_stealing_pool pool(3);
+    std::atomic<int> nested_calls{0};
+    std::atomic<int> late_calls{0};
+    std::mutex late_mutex;
+    std::vector<dp::handler_registration> late_registrations;
+
+    auto nested_reg = evt_bus.register_handler<message_event>(
+        [&nested_calls](const message_event&) { nested_calls.fetch_add(1); });
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < 16; ++i) {
+        registrations.push_back(evt_bus.register_handler<fan_out_event>([&]() {
+            // the shared lock is held by the firing thread, both are deferred or nested safely
+            evt_bus.fire_event(message_event{"nested", 0});
+            auto late = evt_bus.register_handler<message_event>(
+                [&late_calls](const message_event&) { late_calls.fetch_add(1); });
+            std::lock_guard<std::mutex> lock(late_mutex);
+            late_registrations.push_back(std::move(late));
+        }));
+    }
+
+    evt_bus.fire_event_parallel(fan_out_event{}, pool);
+    EXPECT_EQ(nested_calls.load(), 16);
+    EXPECT_EQ(late_calls.load(), 0);
+    EXPECT_EQ(evt_bus.handler_count(), 33);
+
+    evt_bus.fire_event(message_event{"after", 0});
+    EXPECT_EQ(late_calls.load(), 16);
+}
+
+TEST(ParallelDispatch, ConsumingHandlersAreDispatchedInOrder) {
+    dp::event_bus evt_bus;
+    dp::work_stealing_pool pool(2);
+    std::vector<int> order;
+
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < 8; ++i) {
+        registrations.push_back(evt_bus.register_handler<fan_out_event>(
+            [&order, i](const fan_out_event&) {
+                order.push_back(i);
+                return i == 3;
+            },
+            -i));
+    }
+    evt_bus.fire_event_parallel(fan_out_event{}, pool);
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3}));
+}
+
+TEST(ParallelDispatch, KeyedHandlersRunAfterTheOthers) {
+    dp::event_bus evt_bus;
+    dp::work_stealing_pool pool(2);
+    std::atomic<int> unkeyed{0};
+    std::atomic<int> keyed_seen_unkeyed{-1};
+
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < 8; ++i) {
+        registrations.push_back(
+            evt_bus.register_handler<message_event>([&unkeyed]() { unkeyed.fetch_add(1); }));
+    }
+    auto keyed_reg = evt_bus.register_handler<message_event>(
+        &message_event::id, 7, [&]() { keyed_seen_unkeyed = unkeyed.load(); });
+
+    evt_bus.fire_event_parallel(message_event{"keyed", 7}, pool);
+    EXPECT_EQ(keyed_seen_unkeyed.load(), 8);
+}
+
+TEST(ParallelDispatch, ManyThreadsFireOnSmallPool) {
+    dp::event_bus evt_bus(dp::dispatch_mode::lock_free);
+    dp::work_stealing_pool pool(1);
+    std::atomic<int> calls{0};
+
+    std::vector<dp::handler_registration> registrations;
+    for (int i = 0; i < 8; ++i) {
+        registrations.push_back(
+            evt_bus.register_handler<fan_out_event>([&calls]() { calls.fetch_add(1); }));
+    }
+
+    constexpr int threads = 4;
+    constexpr int fires = 200;
+    std::vector<std::thread> firing;
+    for (int t = 0; t < threads; ++t) {
+        firing.emplace_back([&]() {
+            for (int i = 0; i < fires; ++i) {
+                evt_bus.fire_event_parallel(fan_out_event{i}, pool);
+            }
+        });
+    }
+    for (auto& thread : firing) {
+        thread.join();
+    }
+    EXPECT_EQ(calls.load(), threads * fires * 8);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <eventbus/sharded_event_bus.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct trade_event {
+        int quantity{0};
+    };
+
+    struct heartbeat_event {};
+
+    struct symbol_event {
+        std::string symbol;
+    };
+}  // namespace
+
+TEST(ShardedEventBus, RegisterFireAndRemove) {
+    for (const auto mode : {dp::dispatch_mode::locked, dp::dispatch_mode::lock_free}) {
+        dp::sharded_event_bus evt_bus(4, mode);
+        EXPECT_EQ(evt_bus.shard_count(), 4);
+
+        int quantity{0};
+        int heartbeats{0};
+        std::vector<std::string> symbols;
+        auto trade_reg = evt_bus.register_handler<trade_event>(
+            [&quantity](const trade_event& evt) { quantity += evt.quantity; });
+        auto heartbeat_reg =
+            evt_bus.register_handler<heartbeat_event>([&heartbeats]() { ++heartbeats; });
+        auto symbol_reg = evt_bus.register_handler<symbol_event>(
+            &symbol_event::symbol, "AAPL",
+            [&symbols](const symbol_event& evt) { symbols.push_back(evt.symbol); });
+        auto batch_reg = evt_bus.register_batch_handler<trade_event>(
+            [&quantity](dp::event_batch<trade_event> batch) {
+                quantity += static_cast<int>(batch.size()) * 100;
+            });
+        EXPECT_EQ(evt_bus.handler_count(), 4);
+
+        evt_bus.fire_event(trade_event{1});
+        evt_bus.fire_event(heartbeat_event{});
+        evt_bus.fire_event(symbol_event{"AAPL"});
+        evt_bus.fire_event(symbol_event{"MSFT"});
+        const std::vector<trade_event> trades{trade_event{2}, trade_event{3}};
+        evt_bus.fire_events(trades);
+        EXPECT_EQ(quantity, 1 + 100 + 2 + 3 + 200);
+        EXPECT_EQ(heartbeats, 1);
+        EXPECT_EQ(symbols, (std::vector<std::string>{"AAPL"}));
+
+        EXPECT_TRUE(evt_bus.remove_handler(heartbeat_reg));
+        EXPECT_FALSE(evt_bus.remove_handler(heartbeat_reg));
+        batch_reg.unregister();
+        evt_bus.fire_event(heartbeat_event{});
+        evt_bus.fire_event(trade_event{1});
+        EXPECT_EQ(heartbeats, 1);
+        EXPECT_EQ(quantity, 307);
+        EXPECT_EQ(evt_bus.handler_count(), 2);
+
+        evt_bus.remove_handlers();
+        EXPECT_EQ(evt_bus.handler_count(), 0);
+        evt_bus.fire_event(trade_event{1});
+        EXPECT_EQ(quantity, 307);
+    }
+}
+
+TEST(ShardedEventBus, SingleShard) {
+    dp::sharded_event_bus evt_bus(0);
+    EXPECT_EQ(evt_bus.shard_count(), 1);
+    EXPECT_EQ(evt_bus.shard_index<trade_event>(), evt_bus.shard_index<heartbeat_event>());
+
+    int calls{0};
+    auto trade_reg = evt_bus.register_handler<trade_event>([&calls]() { ++calls; });
+    auto heartbeat_reg = evt_bus.register_handler<heartbeat_event>([&calls]() { ++calls; });
+    evt_bus.fire_event(trade_event{});
+    evt_bus.fire_event(heartbeat_event{});
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(ShardedEventBus, UnrelatedTypesDoNotShareLocks) {
+    // enough shards for both types to get one of their own
+    const auto shard_count = std::max<std::size_t>(dp::detail::type_id<trade_event>(),
+                                                   dp::detail::type_id<heartbeat_event>()) +
+                             1;
+    dp::sharded_event_bus evt_bus(shard_count, dp::dispatch_mode::locked);
+    ASSERT_NE(evt_bus.shard_index<trade_event>(), evt_bus.shard_index<heartbeat_event>());
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool dispatching{false};
+    bool released{false};
+    bool timed_out{false};
+    auto blocking_reg = evt_bus.register_handler<trade_event>([&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        dispatching = true;
+        changed.notify_all();
+        timed_out = !changed.wait_for(lock, std::chrono::seconds(10), [&] { return released; });
+    });
+
+    // the dispatch holds the lock of the trade_event shard until it is released
+    auto dispatch_thread = std::thread([&evt_bus]() { evt_bus.fire_event(trade_event{}); });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return dispatching; });
+    }
+
+    // registration needs the exclusive lock, which only has to wait in the same shard
+    std::atomic<int> heartbeats{0};
+    {
+        auto heartbeat_reg =
+            evt_bus.register_handler<heartbeat_event>([&heartbeats]() { ++heartbeats; });
+        evt_bus.fire_event(heartbeat_event{});
+    }
+    EXPECT_EQ(heartbeats.load(), 1);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released = true;
+    }
+    changed.notify_all();
+    dispatch_thread.join();
+    EXPECT_FALSE(timed_out);
+}
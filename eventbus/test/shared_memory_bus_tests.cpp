@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <eventbus/shared_memory_bus.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct price_event {
+        std::uint32_t instrument{0};
+        std::uint64_t sequence{0};
+        double price{0};
+    };
+
+    struct ack_event {
+        std::uint64_t received{0};
+    };
+
+    struct pinned_event {
+        int value{0};
+    };
+
+    // a unique name per test and process, removed when the test ends
+    class segment_name {
+      public:
+        explicit segment_name(const char* test)
+            : name_("/eventbus_" + std::string(test) + "_" + std::to_string(::getpid())) {
+            dp::shared_memory_bus::remove(name_);
+        }
+        ~segment_name() { dp::shared_memory_bus::remove(name_); }
+        [[nodiscard]] const std::string& get() const { return name_; }
+
+      private:
+        std::string name_;
+    };
+
+    template <typename Predicate>
+    bool poll_until(dp::shared_memory_bus& bus, Predicate&& done) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!done()) {
+            if (bus.poll() == 0) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+        }
+        return true;
+    }
+}  // namespace
+
+template <>
+struct dp::shared_event_tag<pinned_event> {
+    static constexpr std::uint64_t value = 42;
+};
+
+TEST(SharedMemoryBus, DeliversToEveryAttachedBus) {
+    const segment_name name("deliver");
+    dp::shared_memory_bus first(name.get(), 8);
+    dp::shared_memory_bus second(name.get());
+    EXPECT_EQ(second.capacity(), 8);
+
+    std::vector<double> first_prices;
+    std::vector<double> second_prices;
+    std::vector<int> pinned;
+    auto first_reg = first.register_handler<price_event>(
+        [&first_prices](const price_event& evt) { first_prices.push_back(evt.price); });
+    auto second_reg = second.register_handler<price_event>(
+        [&second_prices](const price_event& evt) { second_prices.push_back(evt.price); });
+    auto pinned_reg = second.register_handler<pinned_event>(
+        [&pinned](const pinned_event& evt) { pinned.push_back(evt.value); });
+
+    first.fire_event(price_event{1, 0, 1.5});
+    second.fire_event(price_event{1, 1, 2.5});
+    first.fire_event(pinned_event{7});
+    // nothing is delivered before polling
+    EXPECT_TRUE(first_prices.empty());
+
+    EXPECT_EQ(first.poll(), 3);
+    EXPECT_EQ(second.poll(), 3);
+    EXPECT_EQ(first.poll(), 0);
+    EXPECT_EQ(first_prices, (std::vector<double>{1.5, 2.5}));
+    EXPECT_EQ(second_prices, (std::vector<double>{1.5, 2.5}));
+    EXPECT_EQ(pinned, (std::vector<int>{7}));
+
+    EXPECT_TRUE(second.remove_handler(second_reg));
+    first.fire_event(price_event{1, 2, 3.5});
+    EXPECT_EQ(second.poll(1), 1);
+    EXPECT_EQ(second_prices.size(), 2);
+}
+
+TEST(SharedMemoryBus, SlowReaderLosesOverwrittenEvents) {
+    const segment_name name("lost");
+    dp::shared_memory_bus writer(name.get(), 4);
+    dp::shared_memory_bus reader(name.get());
+    std::vector<std::uint64_t> sequences;
+    auto registration = reader.register_handler<price_event>(
+        [&sequences](const price_event& evt) { sequences.push_back(evt.sequence); });
+
+    for (std::uint64_t i = 0; i < 10; ++i) {
+        writer.fire_event(price_event{0, i, 0});
+    }
+    reader.poll();
+    // only the last full ring is left
+    EXPECT_EQ(sequences, (std::vector<std::uint64_t>{6, 7, 8, 9}));
+    EXPECT_EQ(reader.lost_events(), 6);
+}
+
+TEST(SharedMemoryBus, TwoProcesses) {
+    constexpr std::uint64_t event_count = 10000;
+    const segment_name name("processes");
+    // attach before forking, so no event of the child is fired before this bus exists
+    dp::shared_memory_bus parent_bus(name.get(), 1024);
+
+    const auto child = ::fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        // the child attaches on its own and must not return into the test framework
+        int status = 1;
+        try {
+            dp::shared_memory_bus child_bus(name.get());
+            std::uint64_t acknowledged{0};
+            auto registration = child_bus.register_handler<ack_event>(
+                [&acknowledged](const ack_event& evt) { acknowledged = evt.received; });
+            for (std::uint64_t i = 0; i < event_count; ++i) {
+                // stay less than a ring ahead of the parent
+                if (!poll_until(child_bus, [&]() { return i < acknowledged + 512; })) {
+                    ::_exit(2);
+                }
+                child_bus.fire_event(price_event{3, i, static_cast<double>(i)});
+            }
+            const auto all_received = [&acknowledged]() { return acknowledged == event_count; };
+            status = poll_until(child_bus, all_received) ? 0 : 2;
+        } catch (...) {
+            status = 3;
+        }
+        ::_exit(status);
+    }
+
+    std::uint64_t received{0};
+    std::uint64_t out_of_order{0};
+    auto registration =
+        parent_bus.register_handler<price_event>([&](const price_event& evt) {
+            if (evt.sequence != received || evt.instrument != 3) {
+                ++out_of_order;
+            }
+            if (++received % 256 == 0 || received == event_count) {
+                parent_bus.fire_event(ack_event{received});
+            }
+        });
+    EXPECT_TRUE(poll_until(parent_bus, [&received]() { return received >= event_count; }));
+
+    int status{0};
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    EXPECT_EQ(received, event_count);
+    EXPECT_EQ(out_of_order, 0);
+    EXPECT_EQ(parent_bus.lost_events(), 0);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <eventbus/static_event_bus.hpp>
+#include <string>
+#include <type_traits>
+
+namespace {
+    struct position_event {
+        double x{0.0};
+        double y{0.0};
+    };
+
+    struct status_event {
+        std::string status;
+    };
+
+    struct unrelated_event {};
+
+    class position_listener {
+        int count_{0};
+
+      public:
+        void on_position(const position_event&) { ++count_; }
+        void on_any() { ++count_; }
+        [[nodiscard]] int count() const { return count_; }
+    };
+
+    template <typename Bus, typename EventType, typename = void>
+    struct can_fire : std::false_type {};
+
+    template <typename Bus, typename EventType>
+    struct can_fire<Bus, EventType,
+                    std::void_t<decltype(std::declval<Bus&>().fire_event(
+                        std::declval<const EventType&>()))>> : std::true_type {};
+}  // namespace
+
+TEST(StaticEventBus, RegisterFireAndRemove) {
+    using bus_type = dp::static_event_bus<position_event, status_event>;
+    static_assert(can_fire<bus_type, position_event>::value);
+    static_assert(!can_fire<bus_type, unrelated_event>::value);
+
+    bus_type evt_bus;
+    position_listener listener;
+    double x_sum{0.0};
+    std::string last_status;
+
+    auto member_reg =
+        evt_bus.register_handler<position_event>(&listener, &position_listener::on_position);
+    auto no_arg_reg =
+        evt_bus.register_handler<position_event>(&listener, &position_listener::on_any);
+    auto lambda_reg = evt_bus.register_handler<position_event>(
+        [&x_sum](const position_event& evt) { x_sum += evt.x; });
+    auto status_reg = evt_bus.register_handler<status_event>(
+        [&last_status](status_event evt) { last_status = evt.status; });
+    EXPECT_EQ(evt_bus.handler_count(), 4);
+
+    evt_bus.fire_event(position_event{1.5, 2.0});
+    evt_bus.fire_event(status_event{"connected"});
+    EXPECT_EQ(listener.count(), 2);
+    EXPECT_DOUBLE_EQ(x_sum, 1.5);
+    EXPECT_EQ(last_status, "connected");
+
+    EXPECT_TRUE(evt_bus.remove_handler(member_reg));
+    EXPECT_FALSE(evt_bus.remove_handler(member_reg));
+    evt_bus.fire_event(position_event{1.0, 2.0});
+    EXPECT_EQ(listener.count(), 3);
+    EXPECT_DOUBLE_EQ(x_sum, 2.5);
+    EXPECT_EQ(evt_bus.handler_count(), 3);
+
+    evt_bus.remove_handlers();
+    evt_bus.fire_event(position_event{1.0, 2.0});
+    EXPECT_EQ(listener.count(), 3);
+    EXPECT_EQ(evt_bus.handler_count(), 0);
+}
+
+TEST(StaticEventBus, RegistrationsUnregisterOnDestruction) {
+    dp::static_event_bus<position_event> evt_bus;
+    int count{0};
+    {
+        auto registration = evt_bus.register_handler<position_event>([&count]() { ++count; });
+        evt_bus.fire_event(position_event{});
+        EXPECT_EQ(evt_bus.handler_count(), 1);
+    }
+    evt_bus.fire_event(position_event{});
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(evt_bus.handler_count(), 0);
+
+    // registrations of other buses are rejected
+    dp::event_bus dynamic_bus;
+    auto other_reg = dynamic_bus.register_handler<position_event>([]() {});
+    EXPECT_FALSE(evt_bus.remove_handler(other_reg));
+    EXPECT_EQ(dynamic_bus.handler_count(), 1);
+}
+
+TEST(StaticDispatcher, CallsTheHandlersOfTheEventType) {
+    position_listener listener;
+    double x_sum{0.0};
+    std::string last_status;
+
+    dp::static_dispatcher dispatcher{
+        [&x_sum](const position_event& evt) { x_sum += evt.x; },
+        [&last_status](status_event evt) { last_status = evt.status; },
+        [&listener](const position_event& evt) { listener.on_position(evt); }};
+    static_assert(can_fire<decltype(dispatcher), position_event>::value);
+    static_assert(!can_fire<decltype(dispatcher), unrelated_event>::value);
+
+    dispatcher.fire_event(position_event{1.5, 2.0});
+    dispatcher.fire_event(position_event{1.0, 2.0});
+    dispatcher.fire_event(status_event{"connected"});
+    EXPECT_DOUBLE_EQ(x_sum, 2.5);
+    EXPECT_EQ(listener.count(), 2);
+    EXPECT_EQ(last_status, "connected");
+}